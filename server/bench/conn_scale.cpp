@@ -0,0 +1,242 @@
+// Connection scaling benchmark.
+//
+// Opens an increasing number of /audio listeners against a running server and,
+// at every step, measures control-request latency (one new connection per
+// request, /progress by default) together with the server's thread count and
+// RSS read from /proc/<pid>/status, and the rate of listener send syscalls
+// reported by GET /stats (sendmsg on the epoll path, io_uring_enter with
+// AUDIO_IO_URING).
+//
+//   bench_conn_scale --port 8080 --pid $(pidof server) --steps 0,100,500,1000,2000
+//   bench_conn_scale --probe /queue --steps 0,2000,4000
+
+#include <arpa/inet.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Options {
+    std::string host = "127.0.0.1";
+    int port = 8080;
+    int pid = 0;
+    std::vector<int> steps{0, 100, 500, 1000};
+    int probes = 200;
+    std::string probe_path = "/progress";
+};
+
+int connectTo(const Options& opt) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(opt.port));
+    inet_pton(AF_INET, opt.host.c_str(), &addr.sin_addr);
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool sendRequest(int fd, const std::string& path) {
+    std::string req = "GET " + path + " HTTP/1.1\r\nHost: bench\r\n\r\n";
+    return send(fd, req.data(), req.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(req.size());
+}
+
+// Drains all listener sockets so the server never sees a stalled client.
+class ListenerPool {
+public:
+    ListenerPool() : ep(epoll_create1(0)), drainer([this]{ drain(); }) {}
+
+    ~ListenerPool() {
+        stopping = true;
+        drainer.join();
+        for (int fd : fds) close(fd);
+        close(ep);
+    }
+
+    bool add(const Options& opt) {
+        int fd = connectTo(opt);
+        if (fd < 0 || !sendRequest(fd, "/audio")) {
+            if (fd >= 0) close(fd);
+            return false;
+        }
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        epoll_ctl(ep, EPOLL_CTL_ADD, fd, &ev);
+        std::lock_guard<std::mutex> lock(fds_mutex);
+        fds.push_back(fd);
+        return true;
+    }
+
+    size_t size() {
+        std::lock_guard<std::mutex> lock(fds_mutex);
+        return fds.size();
+    }
+
+    uint64_t bytes() const { return received.load(); }
+
+private:
+    int ep;
+    std::vector<int> fds;
+    std::mutex fds_mutex;
+    std::atomic<bool> stopping{false};
+    std::atomic<uint64_t> received{0};
+    std::thread drainer;
+
+    void drain() {
+        std::vector<char> buf(64 * 1024);
+        epoll_event events[256];
+        while (!stopping) {
+            int n = epoll_wait(ep, events, 256, 100);
+            for (int i = 0; i < n; ++i) {
+                ssize_t r;
+                while ((r = recv(events[i].data.fd, buf.data(), buf.size(), 0)) > 0)
+                    received += static_cast<uint64_t>(r);
+                if (r == 0) epoll_ctl(ep, EPOLL_CTL_DEL, events[i].data.fd, nullptr);
+            }
+        }
+    }
+};
+
+// One request per connection, returns latency in milliseconds or -1.
+double probe(const Options& opt, const std::string& path, std::string* response = nullptr) {
+    auto t0 = std::chrono::steady_clock::now();
+    int fd = connectTo(opt);
+    if (fd < 0) return -1;
+    if (!sendRequest(fd, path)) {
+        close(fd);
+        return -1;
+    }
+    char buf[4096];
+    std::string resp;
+    ssize_t r;
+    while ((r = recv(fd, buf, sizeof(buf), 0)) > 0) {
+        resp.append(buf, static_cast<size_t>(r));
+        auto he = resp.find("\r\n\r\n");
+        if (he == std::string::npos) continue;
+        auto cl = resp.find("Content-Length: ");
+        if (cl != std::string::npos && cl < he) {
+            size_t len = std::strtoul(resp.c_str() + cl + 16, nullptr, 10);
+            if (resp.size() >= he + 4 + len) break;
+        }
+    }
+    close(fd);
+    auto t1 = std::chrono::steady_clock::now();
+    if (response) *response = std::move(resp);
+    return std::chrono::duration<double, std::milli>(t1 - t0).count();
+}
+
+// Listener send syscalls so far (sendmsg or io_uring_enter), from GET /stats.
+long sendSyscalls(const Options& opt) {
+    std::string resp;
+    if (probe(opt, "/stats", &resp) < 0) return -1;
+    auto pos = resp.find("\"send_syscalls\":");
+    if (pos == std::string::npos) return -1;
+    return std::strtol(resp.c_str() + pos + 16, nullptr, 10);
+}
+
+void readProcStatus(int pid, long& threads, long& rssKb) {
+    threads = -1;
+    rssKb = -1;
+    if (pid <= 0) return;
+    std::ifstream f("/proc/" + std::to_string(pid) + "/status");
+    std::string line;
+    while (std::getline(f, line)) {
+        if (line.rfind("Threads:", 0) == 0) threads = std::strtol(line.c_str() + 8, nullptr, 10);
+        if (line.rfind("VmRSS:", 0) == 0) rssKb = std::strtol(line.c_str() + 6, nullptr, 10);
+    }
+}
+
+double percentile(std::vector<double> v, double p) {
+    if (v.empty()) return 0.0;
+    std::sort(v.begin(), v.end());
+    size_t idx = static_cast<size_t>(p * (v.size() - 1));
+    return v[idx];
+}
+
+Options parseArgs(int argc, char** argv) {
+    Options opt;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string key = argv[i];
+        std::string val = argv[i + 1];
+        if (key == "--host") opt.host = val;
+        else if (key == "--port") opt.port = std::stoi(val);
+        else if (key == "--pid") opt.pid = std::stoi(val);
+        else if (key == "--probes") opt.probes = std::stoi(val);
+        else if (key == "--probe") opt.probe_path = val;
+        else if (key == "--steps") {
+            opt.steps.clear();
+            std::istringstream iss(val);
+            std::string tok;
+            while (std::getline(iss, tok, ',')) opt.steps.push_back(std::stoi(tok));
+        }
+    }
+    return opt;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options opt = parseArgs(argc, argv);
+
+    rlimit rl{};
+    getrlimit(RLIMIT_NOFILE, &rl);
+    rl.rlim_cur = rl.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &rl);
+
+    ListenerPool pool;
+
+    std::printf("%10s %8s %10s %9s %9s %9s %12s\n", "listeners", "threads", "rss_kb", "p50_ms", "p99_ms", "failed", "send_sc/s");
+    for (int target : opt.steps) {
+        while (static_cast<int>(pool.size()) < target) {
+            if (!pool.add(opt)) {
+                std::cerr << "connect failed at " << pool.size() << " listeners\n";
+                break;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+
+        long sc0 = sendSyscalls(opt);
+        auto sc_t0 = std::chrono::steady_clock::now();
+        std::this_thread::sleep_for(std::chrono::seconds(2));
+        long sc1 = sendSyscalls(opt);
+        double sc_secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - sc_t0).count();
+        double sc_rate = sc0 >= 0 && sc1 >= 0 ? (sc1 - sc0) / sc_secs : -1.0;
+
+        std::vector<double> lat;
+        int failed = 0;
+        for (int i = 0; i < opt.probes; ++i) {
+            double ms = probe(opt, opt.probe_path);
+            if (ms < 0) ++failed;
+            else lat.push_back(ms);
+        }
+
+        long threads, rss;
+        readProcStatus(opt.pid, threads, rss);
+        std::printf("%10zu %8ld %10ld %9.3f %9.3f %9d %12.0f\n", pool.size(), threads, rss,
+                    percentile(lat, 0.50), percentile(lat, 0.99), failed, sc_rate);
+        std::fflush(stdout);
+    }
+    return 0;
+}
@@ -0,0 +1,213 @@
+// Listener fan-out benchmark.
+//
+// Feeds a BroadcastRing at audio rate (without sleeping) and pushes every tick
+// to N loopback TCP listeners using each send strategy. Reports the CPU time of
+// the sending thread per listener per second of audio.
+//
+//   bench_fanout_send --listeners 200 --seconds 30 --chunk 3528
+//
+// Modes:
+//   legacy   - three send() calls per chunk (size line, payload, CRLF)
+//   copy     - chunk framed into a per-listener string, one send()
+//   writev   - flushPending(SendMode::Writev), header + ring spans in one writev
+//   zerocopy - flushPending(SendMode::ZeroCopy), MSG_ZEROCOPY for payloads >= 16 KiB
+
+#include "audio_send.h"
+#include "broadcast_ring.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Options {
+    int listeners = 200;
+    int seconds = 30;
+    size_t chunk = 3528; // 20 ms of 44.1 kHz / 16 bit / stereo
+    int byteRate = 176400;
+};
+
+struct Pair {
+    int sender = -1;
+    int receiver = -1;
+};
+
+std::vector<Pair> makePairs(int count) {
+    int ls = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(ls, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    socklen_t len = sizeof(addr);
+    getsockname(ls, reinterpret_cast<sockaddr*>(&addr), &len);
+    listen(ls, 1024);
+
+    std::vector<Pair> pairs;
+    for (int i = 0; i < count; ++i) {
+        Pair p;
+        p.receiver = socket(AF_INET, SOCK_STREAM, 0);
+        if (connect(p.receiver, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+            perror("connect");
+            break;
+        }
+        p.sender = accept(ls, nullptr, nullptr);
+        fcntl(p.sender, F_SETFL, fcntl(p.sender, F_GETFL, 0) | O_NONBLOCK);
+        fcntl(p.receiver, F_SETFL, fcntl(p.receiver, F_GETFL, 0) | O_NONBLOCK);
+        pairs.push_back(p);
+    }
+    close(ls);
+    return pairs;
+}
+
+void waitWritable(int fd) {
+    pollfd pfd{fd, POLLOUT, 0};
+    poll(&pfd, 1, 1000);
+}
+
+bool sendAll(int fd, const void* data, size_t len) {
+    const char* p = static_cast<const char*>(data);
+    while (len) {
+        ssize_t s = send(fd, p, len, MSG_NOSIGNAL);
+        if (s > 0) {
+            p += s;
+            len -= static_cast<size_t>(s);
+        } else if (s < 0 && (errno == EAGAIN || errno == EINTR)) {
+            waitWritable(fd);
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+double threadCpuSeconds() {
+    rusage ru{};
+    getrusage(RUSAGE_THREAD, &ru);
+    return ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6 + ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+}
+
+double runMode(const std::string& mode, const Options& opt) {
+    std::vector<Pair> pairs = makePairs(opt.listeners);
+
+    std::atomic<bool> stop{false};
+    std::thread drainer([&] {
+        int ep = epoll_create1(0);
+        for (auto& p : pairs) {
+            epoll_event ev{};
+            ev.events = EPOLLIN;
+            ev.data.fd = p.receiver;
+            epoll_ctl(ep, EPOLL_CTL_ADD, p.receiver, &ev);
+        }
+        std::vector<char> buf(256 * 1024);
+        epoll_event events[256];
+        while (!stop) {
+            int n = epoll_wait(ep, events, 256, 50);
+            for (int i = 0; i < n; ++i)
+                while (recv(events[i].data.fd, buf.data(), buf.size(), 0) > 0) {}
+        }
+        close(ep);
+    });
+
+    BroadcastRing ring(6 * 1024 * 1024);
+    std::vector<uint8_t> pcm(opt.chunk);
+    for (size_t i = 0; i < pcm.size(); ++i) pcm[i] = static_cast<uint8_t>(i * 31);
+
+    SendMode sendMode = mode == "zerocopy" ? SendMode::ZeroCopy : SendMode::Writev;
+    if (sendMode == SendMode::ZeroCopy)
+        for (auto& p : pairs)
+            if (!enableZeroCopy(p.sender)) std::cerr << "SO_ZEROCOPY unsupported\n";
+
+    std::vector<PendingSend> pending(pairs.size());
+    std::vector<ZeroCopyTracker> inflight(pairs.size());
+    std::string framed;
+
+    const long ticks = static_cast<long>(opt.seconds) * opt.byteRate / static_cast<long>(opt.chunk);
+    double cpu0 = threadCpuSeconds();
+
+    for (long t = 0; t < ticks; ++t) {
+        uint64_t from = ring.head();
+        ring.write(pcm.data(), pcm.size());
+
+        char sizeLine[32];
+        int m = std::snprintf(sizeLine, sizeof(sizeLine), "%zx\r\n", pcm.size());
+
+        for (size_t i = 0; i < pairs.size(); ++i) {
+            int fd = pairs[i].sender;
+            if (mode == "legacy") {
+                sendAll(fd, sizeLine, static_cast<size_t>(m));
+                sendAll(fd, pcm.data(), pcm.size());
+                sendAll(fd, "\r\n", 2);
+            } else if (mode == "copy") {
+                framed.assign(sizeLine, static_cast<size_t>(m));
+                framed.append(reinterpret_cast<const char*>(pcm.data()), pcm.size());
+                framed += "\r\n";
+                sendAll(fd, framed.data(), framed.size());
+            } else {
+                PendingSend& p = pending[i];
+                p.reset();
+                if (t) p.prefix = "\r\n";
+                p.prefix.append(sizeLine, static_cast<size_t>(m));
+                p.data_begin = from;
+                p.data_end = ring.head();
+                while (true) {
+                    SendStatus st = flushPending(fd, p, ring, sendMode, &inflight[i]);
+                    if (st != SendStatus::WouldBlock) break;
+                    waitWritable(fd);
+                }
+            }
+        }
+    }
+
+    double cpu = threadCpuSeconds() - cpu0;
+    stop = true;
+    drainer.join();
+    for (auto& p : pairs) {
+        close(p.sender);
+        close(p.receiver);
+    }
+    return cpu;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options opt;
+    std::vector<std::string> modes{"legacy", "copy", "writev", "zerocopy"};
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string key = argv[i];
+        std::string val = argv[i + 1];
+        if (key == "--listeners") opt.listeners = std::stoi(val);
+        else if (key == "--seconds") opt.seconds = std::stoi(val);
+        else if (key == "--chunk") opt.chunk = std::stoul(val);
+        else if (key == "--byte-rate") opt.byteRate = std::stoi(val);
+        else if (key == "--mode") modes = {val};
+    }
+
+    rlimit rl{};
+    getrlimit(RLIMIT_NOFILE, &rl);
+    rl.rlim_cur = rl.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &rl);
+
+    std::printf("%-9s %10s %10s %16s\n", "mode", "listeners", "cpu_s", "cpu_us/lst/sec");
+    for (const auto& mode : modes) {
+        double cpu = runMode(mode, opt);
+        double perListener = cpu * 1e6 / opt.listeners / opt.seconds;
+        std::printf("%-9s %10d %10.3f %16.1f\n", mode.c_str(), opt.listeners, cpu, perListener);
+        std::fflush(stdout);
+    }
+    return 0;
+}
@@ -0,0 +1,191 @@
+// Time-to-first-sound benchmark.
+//
+// Connects to /audio over and over, the way a browser joins the stream, and
+// measures how long it takes until the client holds enough audio to start
+// playing: the time to the first PCM byte and the time until --buffer-ms of
+// PCM (byte rate taken from the WAV header) has arrived. A player such as
+// <audio> only starts once its buffer is filled, so the second number is what
+// the listener perceives as start-up latency.
+//
+//   bench_first_sound --port 8080 --runs 20 --buffer-ms 500
+
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::string host = "127.0.0.1";
+    int port = 8080;
+    int runs = 20;
+    int buffer_ms = 500;
+    int timeout_s = 10;
+    int pause_ms = 200;
+    std::string path = "/audio";
+};
+
+struct Sample {
+    double first_byte_ms = -1;
+    double playable_ms = -1;
+};
+
+// Minimal chunked decoder: feeds payload bytes to `out` as they arrive.
+class Dechunker {
+public:
+    void feed(const char* data, size_t len, std::string& out) {
+        buf.append(data, len);
+        while (true) {
+            if (remaining == 0) {
+                auto eol = buf.find("\r\n", pos);
+                if (eol == std::string::npos) break;
+                if (eol == pos) { // CRLF closing the previous chunk
+                    pos += 2;
+                    continue;
+                }
+                remaining = std::strtoull(buf.c_str() + pos, nullptr, 16);
+                pos = eol + 2;
+                if (remaining == 0) {
+                    done = true;
+                    break;
+                }
+            }
+            size_t take = std::min<size_t>(remaining, buf.size() - pos);
+            if (take == 0) break;
+            out.append(buf, pos, take);
+            pos += take;
+            remaining -= take;
+        }
+        buf.erase(0, pos);
+        pos = 0;
+    }
+
+    bool finished() const { return done; }
+
+private:
+    std::string buf;
+    size_t pos = 0;
+    uint64_t remaining = 0;
+    bool done = false;
+};
+
+uint32_t readU32(const std::string& s, size_t off) {
+    const auto* p = reinterpret_cast<const unsigned char*>(s.data() + off);
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (uint32_t(p[3]) << 24);
+}
+
+Sample measure(const Options& opt) {
+    Sample sample;
+    auto t0 = Clock::now();
+    auto since = [&t0] { return std::chrono::duration<double, std::milli>(Clock::now() - t0).count(); };
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return sample;
+    timeval tv{opt.timeout_s, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(opt.port));
+    inet_pton(AF_INET, opt.host.c_str(), &addr.sin_addr);
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        close(fd);
+        return sample;
+    }
+    std::string req = "GET " + opt.path + " HTTP/1.1\r\nHost: bench\r\n\r\n";
+    send(fd, req.data(), req.size(), MSG_NOSIGNAL);
+
+    std::string head, body;
+    bool in_body = false;
+    Dechunker dechunk;
+    uint64_t need = 0;
+    char buf[64 * 1024];
+    while (since() < opt.timeout_s * 1000.0) {
+        ssize_t r = recv(fd, buf, sizeof(buf), 0);
+        if (r <= 0) break;
+        if (!in_body) {
+            head.append(buf, static_cast<size_t>(r));
+            auto he = head.find("\r\n\r\n");
+            if (he == std::string::npos) continue;
+            in_body = true;
+            dechunk.feed(head.data() + he + 4, head.size() - he - 4, body);
+        } else {
+            dechunk.feed(buf, static_cast<size_t>(r), body);
+        }
+
+        if (body.size() < 44) continue;
+        if (need == 0) {
+            uint32_t byte_rate = readU32(body, 28);
+            need = 44 + uint64_t(byte_rate) * opt.buffer_ms / 1000;
+        }
+        if (sample.first_byte_ms < 0 && body.size() > 44)
+            sample.first_byte_ms = since();
+        if (body.size() >= need) {
+            sample.playable_ms = since();
+            break;
+        }
+        if (dechunk.finished()) break;
+    }
+    close(fd);
+    return sample;
+}
+
+double percentile(std::vector<double> v, double p) {
+    if (v.empty()) return 0.0;
+    std::sort(v.begin(), v.end());
+    size_t idx = static_cast<size_t>(p * (v.size() - 1));
+    return v[idx];
+}
+
+Options parseArgs(int argc, char** argv) {
+    Options opt;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string key = argv[i];
+        std::string val = argv[i + 1];
+        if (key == "--host") opt.host = val;
+        else if (key == "--port") opt.port = std::stoi(val);
+        else if (key == "--runs") opt.runs = std::stoi(val);
+        else if (key == "--buffer-ms") opt.buffer_ms = std::stoi(val);
+        else if (key == "--timeout") opt.timeout_s = std::stoi(val);
+        else if (key == "--pause-ms") opt.pause_ms = std::stoi(val);
+        else if (key == "--path") opt.path = val;
+    }
+    return opt;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options opt = parseArgs(argc, argv);
+
+    std::vector<double> first, playable;
+    int failed = 0;
+    for (int i = 0; i < opt.runs; ++i) {
+        Sample s = measure(opt);
+        if (s.playable_ms < 0) ++failed;
+        else {
+            first.push_back(s.first_byte_ms);
+            playable.push_back(s.playable_ms);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(opt.pause_ms));
+    }
+
+    std::printf("%6s %7s %12s %12s %12s %12s %12s\n", "runs", "failed", "first_p50", "first_p99",
+                "play_p50", "play_p99", "play_max");
+    std::printf("%6d %7d %12.1f %12.1f %12.1f %12.1f %12.1f\n", opt.runs, failed,
+                percentile(first, 0.50), percentile(first, 0.99),
+                percentile(playable, 0.50), percentile(playable, 0.99), percentile(playable, 1.0));
+    std::printf("(ms; play = %d ms of audio buffered)\n", opt.buffer_ms);
+    return 0;
+}
@@ -0,0 +1,134 @@
+// HTTP request parsing microbenchmark.
+//
+// Compares HttpParser against the previous approach in handleHttpClient
+// (std::string copies of headers/body plus istringstream scans for
+// Content-Length and boundary). Each request is also fed in small slices to
+// measure the incremental path used when headers span several TCP segments.
+//
+//   bench_http_parse --iterations 1000000
+
+#include "http_parser.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+const std::vector<std::string> kRequests = {
+    "GET /progress HTTP/1.1\r\n"
+    "Host: 127.0.0.1:8080\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/126.0 Safari/537.36\r\n"
+    "Accept: */*\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Accept-Language: pl-PL,pl;q=0.9,en-US;q=0.8,en;q=0.7\r\n"
+    "Cache-Control: no-store\r\n"
+    "Connection: keep-alive\r\n"
+    "Referer: http://127.0.0.1:8080/\r\n\r\n",
+
+    "POST /queue/move HTTP/1.1\r\n"
+    "Host: 127.0.0.1:8080\r\n"
+    "Content-Type: application/x-www-form-urlencoded\r\n"
+    "Content-Length: 11\r\n"
+    "Origin: http://127.0.0.1:8080\r\n"
+    "Connection: keep-alive\r\n\r\n"
+    "from=2&to=0",
+};
+
+long legacyContentLength(const std::string& headers) {
+    std::istringstream iss(headers);
+    std::string line;
+    while (std::getline(iss, line)) {
+        if (line.size() && (line.back() == '\r')) line.pop_back();
+        std::string key = "Content-Length:";
+        if (line.size() >= key.size() && std::equal(key.begin(), key.end(), line.begin(), [](char a, char b) { return std::tolower(a) == std::tolower(b); })) {
+            try {
+                return std::stol(line.substr(key.size()));
+            } catch (...) { return -1; }
+        }
+    }
+    return -1;
+}
+
+std::string legacyBoundary(const std::string& headers) {
+    std::istringstream iss(headers);
+    std::string line;
+    while (std::getline(iss, line)) {
+        if (line.size() && (line.back() == '\r')) line.pop_back();
+        std::string key = "Content-Type:";
+        if (line.size() >= key.size() && std::equal(key.begin(), key.end(), line.begin(), [](char a, char b) { return std::tolower(a) == std::tolower(b); })) {
+            auto pos = line.find("boundary=");
+            if (pos != std::string::npos) return line.substr(pos + 9);
+        }
+    }
+    return {};
+}
+
+size_t legacyParse(const char* buffer) {
+    std::string request(buffer);
+    size_t header_end = request.find("\r\n\r\n");
+    std::string headers = header_end != std::string::npos ? request.substr(0, header_end) : request;
+    std::string body = header_end != std::string::npos ? request.substr(header_end + 4) : std::string();
+    long content_length = legacyContentLength(headers);
+    std::string boundary = legacyBoundary(headers);
+    size_t method_end = headers.find(' ');
+    size_t path_end = headers.find(' ', method_end + 1);
+    std::string method = headers.substr(0, method_end);
+    std::string path = headers.substr(method_end + 1, path_end - method_end - 1);
+    return method.size() + path.size() + body.size() + boundary.size() + static_cast<size_t>(content_length + 1);
+}
+
+size_t parserParse(HttpParser& parser, const std::string& req) {
+    parser.reset();
+    if (parser.parse(req) != HttpParser::Status::Complete) return 0;
+    const HttpRequest& r = parser.request();
+    return r.method.size() + r.path.size() + r.body.size() + multipartBoundary(r.header("Content-Type")).size();
+}
+
+size_t parserParseSliced(HttpParser& parser, const std::string& req, size_t slice) {
+    parser.reset();
+    for (size_t end = slice;; end += slice) {
+        std::string_view view(req.data(), std::min(end, req.size()));
+        if (parser.parse(view) == HttpParser::Status::Complete) break;
+        if (end >= req.size()) return 0;
+    }
+    return parser.request().path.size();
+}
+
+template <typename F>
+void run(const char* name, long iterations, size_t bytesPerIter, F&& fn) {
+    size_t sink = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (long i = 0; i < iterations; ++i) sink += fn(i);
+    auto t1 = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / iterations;
+    double mbs = bytesPerIter / ns * 1e3;
+    std::printf("%-22s %10.1f ns/req %10.1f MB/s   (sink %zu)\n", name, ns, mbs, sink % 10);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    long iterations = 1000000;
+    for (int i = 1; i + 1 < argc; i += 2)
+        if (std::string(argv[i]) == "--iterations") iterations = std::stol(argv[i + 1]);
+
+    size_t avgBytes = 0;
+    for (auto& r : kRequests) avgBytes += r.size();
+    avgBytes /= kRequests.size();
+
+    HttpParser parser;
+    run("legacy (string+sstream)", iterations, avgBytes, [&](long i) {
+        return legacyParse(kRequests[static_cast<size_t>(i) % kRequests.size()].c_str());
+    });
+    run("HttpParser", iterations, avgBytes, [&](long i) {
+        return parserParse(parser, kRequests[static_cast<size_t>(i) % kRequests.size()]);
+    });
+    run("HttpParser 64B slices", iterations / 4, avgBytes, [&](long i) {
+        return parserParseSliced(parser, kRequests[static_cast<size_t>(i) % kRequests.size()], 64);
+    });
+    return 0;
+}
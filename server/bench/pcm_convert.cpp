@@ -0,0 +1,181 @@
+// PCM -> float conversion microbenchmark.
+//
+// Compares the conversion kernels behind pcmToFloat (scalar, SSE2, AVX2 -
+// whichever the CPU supports) against the previous per-sample loop from
+// portaudioCallback, which branched on the bit depth and bounds-checked every
+// sample against the track size. Input is interleaved stereo noise converted
+// in callback-sized buffers (--frames per buffer); every kernel's output is
+// checked against the old loop. The crossfade mix (mixCrossfade) is timed the
+// same way, each kernel checked against the scalar one.
+//
+//   bench_pcm_convert --seconds 60 --frames 256 --repeat 20
+
+#include "pcm_convert.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int kChannels = 2;
+constexpr int kSampleRate = 48000;
+
+struct Options {
+    double seconds = 60.0;     // audio per pass
+    size_t frames = 256;       // frames per buffer (PortAudio callback)
+    int repeat = 20;
+};
+
+// Previous portaudioCallback inner loop, kept as the baseline.
+void legacyConvert(const std::vector<uint8_t>& data, size_t pos, int bits, int channels,
+                   unsigned long frames, float* out) {
+    const int sampleSize = bits / 8;
+    const size_t frameSize = static_cast<size_t>(sampleSize * channels);
+    for (unsigned long i = 0; i < frames; ++i) {
+        for (int ch = 0; ch < channels; ++ch) {
+            size_t byteIndex = pos + static_cast<size_t>(ch * sampleSize);
+            if (byteIndex + sampleSize <= data.size()) {
+                const uint8_t* p = data.data() + byteIndex;
+                float sampleOut = 0.0f;
+                if (bits == 24) {
+                    int32_t sample = (p[0]) | (p[1] << 8) | (p[2] << 16);
+                    if (sample & 0x800000) sample |= ~0xFFFFFF;
+                    sampleOut = sample / 8388608.0f;
+                } else if (bits == 16) {
+                    int16_t sample = static_cast<int16_t>(p[0] | (p[1] << 8));
+                    sampleOut = sample / 32768.0f;
+                }
+                out[i * channels + ch] = sampleOut;
+            } else {
+                out[i * channels + ch] = 0.0f;
+            }
+        }
+        pos += frameSize;
+    }
+}
+
+template <typename Fn>
+double samplesPerSecond(size_t samples, int repeat, Fn&& pass) {
+    double best = 0.0;
+    for (int r = 0; r < repeat; ++r) {
+        auto start = Clock::now();
+        pass();
+        double secs = std::chrono::duration<double>(Clock::now() - start).count();
+        if (secs > 0.0 && samples / secs > best) best = samples / secs;
+    }
+    return best;
+}
+
+volatile float g_sink;
+
+void run(const Options& opt, int bits) {
+    const size_t sample_bytes = static_cast<size_t>(bits / 8);
+    const size_t frame_bytes = sample_bytes * kChannels;
+    const size_t frames = static_cast<size_t>(opt.seconds * kSampleRate) / opt.frames * opt.frames;
+    const size_t samples = frames * kChannels;
+
+    std::vector<uint8_t> data(frames * frame_bytes);
+    std::mt19937 rng(bits);
+    for (auto& b : data) b = static_cast<uint8_t>(rng());
+
+    std::vector<float> expected(samples);
+    std::vector<float> out(samples);
+    for (size_t f = 0; f < frames; f += opt.frames)
+        legacyConvert(data, f * frame_bytes, bits, kChannels, opt.frames, expected.data() + f * kChannels);
+
+    double legacy = samplesPerSecond(samples, opt.repeat, [&] {
+        for (size_t f = 0; f < frames; f += opt.frames)
+            legacyConvert(data, f * frame_bytes, bits, kChannels, opt.frames, out.data() + f * kChannels);
+        g_sink = out[samples / 2];
+    });
+    std::printf("%2d-bit  %-8s %8.1f Msamples/s\n", bits, "legacy", legacy / 1e6);
+
+    for (PcmKernel kernel : {PcmKernel::Scalar, PcmKernel::Sse2, PcmKernel::Avx2}) {
+        if (!pcmKernelSupported(kernel)) {
+            std::printf("%2d-bit  %-8s      n/a\n", bits, pcmKernelName(kernel));
+            continue;
+        }
+        const size_t buffer = opt.frames * kChannels;
+        double rate = samplesPerSecond(samples, opt.repeat, [&] {
+            for (size_t s = 0; s < samples; s += buffer)
+                pcmToFloat(data.data() + s * sample_bytes, buffer, bits, out.data() + s, kernel);
+            g_sink = out[samples / 2];
+        });
+        bool same = std::memcmp(out.data(), expected.data(), samples * sizeof(float)) == 0;
+        std::printf("%2d-bit  %-8s %8.1f Msamples/s  x%.1f%s\n", bits, pcmKernelName(kernel), rate / 1e6,
+                    rate / legacy, same ? "" : "  OUTPUT MISMATCH");
+    }
+}
+
+void runMix(const Options& opt) {
+    const size_t frames = static_cast<size_t>(opt.seconds * kSampleRate) / opt.frames * opt.frames;
+    const size_t samples = frames * kChannels;
+    const size_t buffer = opt.frames * kChannels;
+
+    std::vector<float> a(samples), b(samples), expected(samples), out(samples);
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    for (size_t i = 0; i < samples; ++i) {
+        a[i] = dist(rng);
+        b[i] = dist(rng);
+    }
+    auto pass = [&](PcmKernel kernel, std::vector<float>& dst) {
+        for (size_t s = 0; s < samples; s += buffer) {
+            const float t0 = static_cast<float>(s) / samples, t1 = static_cast<float>(s + buffer) / samples;
+            mixCrossfade(a.data() + s, b.data() + s, dst.data() + s, opt.frames, kChannels,
+                         1.0f - t0, 1.0f - t1, t0, t1, kernel);
+        }
+    };
+    pass(PcmKernel::Scalar, expected);
+
+    double scalar = 0.0;
+    for (PcmKernel kernel : {PcmKernel::Scalar, PcmKernel::Sse2, PcmKernel::Avx2}) {
+        if (!pcmKernelSupported(kernel)) {
+            std::printf("mix     %-8s      n/a\n", pcmKernelName(kernel));
+            continue;
+        }
+        double rate = samplesPerSecond(samples, opt.repeat, [&] {
+            pass(kernel, out);
+            g_sink = out[samples / 2];
+        });
+        if (kernel == PcmKernel::Scalar) scalar = rate;
+        bool same = std::memcmp(out.data(), expected.data(), samples * sizeof(float)) == 0;
+        std::printf("mix     %-8s %8.1f Msamples/s  x%.1f%s\n", pcmKernelName(kernel), rate / 1e6,
+                    rate / scalar, same ? "" : "  OUTPUT MISMATCH");
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options opt;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        if (arg == "--seconds") opt.seconds = std::atof(argv[i + 1]);
+        else if (arg == "--frames") opt.frames = std::strtoul(argv[i + 1], nullptr, 10);
+        else if (arg == "--repeat") opt.repeat = std::atoi(argv[i + 1]);
+        else {
+            std::fprintf(stderr, "usage: %s [--seconds S] [--frames N] [--repeat R]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (opt.frames == 0 || opt.repeat <= 0 || opt.seconds * kSampleRate < opt.frames) {
+        std::fprintf(stderr, "invalid options\n");
+        return 1;
+    }
+
+    std::printf("%g s of %d Hz stereo, %zu frames per buffer, best of %d; runtime pick: %s\n",
+                opt.seconds, kSampleRate, opt.frames, opt.repeat, pcmKernelName(pcmKernel()));
+    run(opt, 16);
+    run(opt, 24);
+    runMix(opt);
+    return 0;
+}
@@ -0,0 +1,243 @@
+// Reconnect storm benchmark.
+//
+// Simulates all listeners reconnecting at once (e.g. after a track change):
+// every round fires --clients non-blocking connects back to back, sends one
+// request per connection (/audio by default) and waits for the response
+// headers. Reports the accept rate (connections answered per second), connect
+// and first-response latency percentiles (a dropped SYN shows up as a ~1 s
+// retransmit) and the SYN drops counted by the kernel while the round ran
+// (TcpExt ListenOverflows / ListenDrops from /proc/net/netstat, so run it on
+// the server host). The per-reactor accept split comes from GET /stats.
+//
+//   bench_reconnect_storm --port 8080 --clients 2000 --rounds 5
+
+#include <arpa/inet.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::string host = "127.0.0.1";
+    int port = 8080;
+    int clients = 1000;
+    int rounds = 3;
+    int timeout_s = 15;
+    std::string path = "/audio";
+};
+
+struct Client {
+    int fd = -1;
+    bool connected = false;
+    std::string head;
+    double connect_ms = -1;
+    double response_ms = -1;
+};
+
+struct ListenCounters {
+    long overflows = 0;
+    long drops = 0;
+};
+
+// TcpExt names and values come as two consecutive lines.
+ListenCounters readListenCounters() {
+    ListenCounters c;
+    std::ifstream f("/proc/net/netstat");
+    std::string names, values;
+    while (std::getline(f, names) && std::getline(f, values)) {
+        if (names.rfind("TcpExt:", 0) != 0) continue;
+        std::istringstream n(names), v(values);
+        std::string key, val;
+        while (n >> key && v >> val) {
+            if (key == "ListenOverflows") c.overflows = std::strtol(val.c_str(), nullptr, 10);
+            if (key == "ListenDrops") c.drops = std::strtol(val.c_str(), nullptr, 10);
+        }
+    }
+    return c;
+}
+
+double percentile(std::vector<double> v, double p) {
+    if (v.empty()) return 0.0;
+    std::sort(v.begin(), v.end());
+    size_t idx = static_cast<size_t>(p * (v.size() - 1));
+    return v[idx];
+}
+
+// "accepted":[a,b,...] from GET /stats, blocking request on a fresh connection.
+std::string acceptedPerReactor(const Options& opt) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return "?";
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(opt.port));
+    inet_pton(AF_INET, opt.host.c_str(), &addr.sin_addr);
+    std::string resp;
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) {
+        std::string req = "GET /stats HTTP/1.1\r\nHost: bench\r\nConnection: close\r\n\r\n";
+        send(fd, req.data(), req.size(), MSG_NOSIGNAL);
+        char buf[4096];
+        ssize_t r;
+        while ((r = recv(fd, buf, sizeof(buf), 0)) > 0)
+            resp.append(buf, static_cast<size_t>(r));
+    }
+    close(fd);
+    auto pos = resp.find("\"accepted\":[");
+    if (pos == std::string::npos) return "?";
+    auto end = resp.find(']', pos);
+    return resp.substr(pos + 11, end - pos - 10);
+}
+
+void runRound(const Options& opt, int round) {
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(opt.port));
+    inet_pton(AF_INET, opt.host.c_str(), &addr.sin_addr);
+    const std::string req = "GET " + opt.path + " HTTP/1.1\r\nHost: bench\r\n\r\n";
+
+    int ep = epoll_create1(0);
+    std::vector<Client> clients(static_cast<size_t>(opt.clients));
+    ListenCounters before = readListenCounters();
+    auto t0 = Clock::now();
+    auto since = [&t0] { return std::chrono::duration<double, std::milli>(Clock::now() - t0).count(); };
+
+    int failed = 0;
+    for (size_t i = 0; i < clients.size(); ++i) {
+        Client& c = clients[i];
+        c.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        if (c.fd < 0) {
+            ++failed;
+            continue;
+        }
+        if (connect(c.fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 && errno != EINPROGRESS) {
+            close(c.fd);
+            c.fd = -1;
+            ++failed;
+            continue;
+        }
+        epoll_event ev{};
+        ev.events = EPOLLOUT;
+        ev.data.u64 = i;
+        epoll_ctl(ep, EPOLL_CTL_ADD, c.fd, &ev);
+    }
+
+    int pending = opt.clients - failed;
+    epoll_event events[256];
+    char buf[4096];
+    while (pending > 0 && since() < opt.timeout_s * 1000.0) {
+        int n = epoll_wait(ep, events, 256, 100);
+        for (int k = 0; k < n; ++k) {
+            Client& c = clients[events[k].data.u64];
+            if (c.fd < 0) continue;
+
+            if (!c.connected) {
+                int err = 0;
+                socklen_t len = sizeof(err);
+                getsockopt(c.fd, SOL_SOCKET, SO_ERROR, &err, &len);
+                if (err != 0 || send(c.fd, req.data(), req.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(req.size())) {
+                    close(c.fd);
+                    c.fd = -1;
+                    ++failed;
+                    --pending;
+                    continue;
+                }
+                c.connected = true;
+                c.connect_ms = since();
+                epoll_event ev{};
+                ev.events = EPOLLIN;
+                ev.data.u64 = events[k].data.u64;
+                epoll_ctl(ep, EPOLL_CTL_MOD, c.fd, &ev);
+                continue;
+            }
+
+            ssize_t r = recv(c.fd, buf, sizeof(buf), 0);
+            if (r > 0 && c.head.size() < 4096)
+                c.head.append(buf, static_cast<size_t>(r));
+            bool done = c.head.find("\r\n\r\n") != std::string::npos;
+            if (done || r == 0 || (r < 0 && errno != EAGAIN)) {
+                if (done) c.response_ms = since();
+                else ++failed;
+                close(c.fd);
+                c.fd = -1;
+                --pending;
+            }
+        }
+    }
+
+    for (auto& c : clients) {
+        if (c.fd < 0) continue;
+        close(c.fd);
+        ++failed; // timeout
+    }
+    close(ep);
+    ListenCounters after = readListenCounters();
+
+    std::vector<double> connect_ms, response_ms;
+    double last_ms = 0;
+    for (auto& c : clients) {
+        if (c.connect_ms >= 0) connect_ms.push_back(c.connect_ms);
+        if (c.response_ms >= 0) {
+            response_ms.push_back(c.response_ms);
+            last_ms = std::max(last_ms, c.response_ms);
+        }
+    }
+    double rate = last_ms > 0 ? response_ms.size() * 1000.0 / last_ms : 0.0;
+
+    std::printf("%5d %7zu %7d %10.0f %9.1f %9.1f %9.1f %9.1f %9ld %9ld\n", round, response_ms.size(), failed, rate,
+                percentile(connect_ms, 0.50), percentile(connect_ms, 0.99),
+                percentile(response_ms, 0.50), percentile(response_ms, 0.99),
+                after.overflows - before.overflows, after.drops - before.drops);
+    std::fflush(stdout);
+}
+
+Options parseArgs(int argc, char** argv) {
+    Options opt;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string key = argv[i];
+        std::string val = argv[i + 1];
+        if (key == "--host") opt.host = val;
+        else if (key == "--port") opt.port = std::stoi(val);
+        else if (key == "--clients") opt.clients = std::stoi(val);
+        else if (key == "--rounds") opt.rounds = std::stoi(val);
+        else if (key == "--timeout") opt.timeout_s = std::stoi(val);
+        else if (key == "--path") opt.path = val;
+    }
+    return opt;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options opt = parseArgs(argc, argv);
+
+    rlimit rl{};
+    getrlimit(RLIMIT_NOFILE, &rl);
+    rl.rlim_cur = rl.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &rl);
+
+    std::printf("%5s %7s %7s %10s %9s %9s %9s %9s %9s %9s\n", "round", "ok", "failed", "accept/s",
+                "conn_p50", "conn_p99", "resp_p50", "resp_p99", "overflow", "drops");
+    for (int round = 1; round <= opt.rounds; ++round) {
+        runRound(opt, round);
+        // let the server notice the abandoned listeners before the next wave
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+    }
+    std::printf("accepted per reactor: %s\n", acceptedPerReactor(opt).c_str());
+    return 0;
+}
@@ -0,0 +1,75 @@
+// libFuzzer target for HttpParser.
+//
+// The first input byte picks a slice size, the rest is fed to the parser in
+// growing prefixes the way handleHttpClient sees partial reads. Pipelined
+// requests are consumed until the input runs out or the parser rejects it.
+
+#include "http_parser.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+
+static void check(bool ok) {
+    if (!ok) std::abort();
+}
+
+static bool within(std::string_view outer, std::string_view inner) {
+    return inner.empty() || (inner.data() >= outer.data() &&
+                             inner.data() + inner.size() <= outer.data() + outer.size());
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    if (size == 0) return 0;
+    const size_t slice = static_cast<size_t>(data[0] % 64) + 1;
+
+    // kopia w std::string jak bufor polaczenia (realokowany miedzy odczytami)
+    std::string buffer;
+    std::string_view input(reinterpret_cast<const char*>(data + 1), size - 1);
+
+    HttpParser parser(1024, 4096);
+    size_t start = 0;
+    size_t fed = 0;
+    while (fed < input.size()) {
+        fed = std::min(input.size(), fed + slice);
+        buffer.assign(input.data(), fed);
+
+        while (true) {
+            std::string_view pending(buffer);
+            pending.remove_prefix(start);
+            HttpParser::Status status = parser.parse(pending);
+            if (status == HttpParser::Status::NeedMore) break;
+            if (status == HttpParser::Status::Error) {
+                int code = parser.errorStatus();
+                check(code == 400 || code == 413 || code == 431 || code == 501);
+                return 0;
+            }
+
+            const HttpRequest& req = parser.request();
+            check(parser.consumed() > 0 && parser.consumed() <= pending.size());
+            std::string_view used = pending.substr(0, parser.consumed());
+            check(within(used, req.method) && !req.method.empty());
+            check(within(used, req.target) && within(used, req.path) && within(used, req.query));
+            check(within(used, req.body));
+            check(req.content_length < 0 || req.body.size() == static_cast<size_t>(req.content_length));
+            check(req.header_count <= HttpRequest::MAX_HEADERS);
+            for (size_t i = 0; i < req.header_count; ++i)
+                check(within(used, req.headers[i].name) && within(used, req.headers[i].value));
+            multipartBoundary(req.header("Content-Type"));
+
+            uint64_t first = 0, last = 0;
+            const uint64_t total = 1 + fed % 100000;
+            if (parseByteRange(req.header("Range"), total, first, last) == RangeResult::Satisfiable)
+                check(first <= last && last < total);
+
+            QueryParams query(req.query);
+            query.getInt("t");
+            query.getDouble("t");
+
+            start += parser.consumed();
+            parser.reset();
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,20 @@
+// Driver for compilers without libFuzzer: replays every file given on the
+// command line through LLVMFuzzerTestOneInput (e.g. the seed corpus).
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; ++i) {
+        std::ifstream f(argv[i], std::ios::binary);
+        std::vector<uint8_t> data((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+        LLVMFuzzerTestOneInput(data.data(), data.size());
+    }
+    std::printf("replayed %d input(s)\n", argc - 1);
+    return 0;
+}
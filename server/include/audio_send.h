@@ -0,0 +1,75 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <deque>
+#include <string>
+#include "broadcast_ring.h"
+
+// Sposob wysylania danych PCM z BroadcastRing do gniazda sluchacza.
+enum class SendMode {
+    Writev,   // naglowek chunku i dane z ring jednym writev, bez kopii w przestrzeni uzytkownika
+    ZeroCopy, // dane z ring przez MSG_ZEROCOPY (duze fragmenty), reszta jak Writev
+};
+
+enum class SendStatus { Done, WouldBlock, Error };
+
+// Oczekujace dane: najpierw bajty prefix (ramki HTTP), potem zakres ring.
+struct PendingSend {
+    std::string prefix;
+    size_t prefix_offset = 0;
+    uint64_t data_begin = 0;
+    uint64_t data_end = 0;
+
+    bool empty() const { return prefix_offset == prefix.size() && data_begin == data_end; }
+    void reset() { prefix.clear(); prefix_offset = 0; data_begin = data_end = 0; }
+};
+
+// Ponizej tego rozmiaru MSG_ZEROCOPY kosztuje wiecej niz kopia (przypinanie stron + powiadomienia).
+constexpr size_t ZEROCOPY_MIN_BYTES = 16 * 1024;
+
+// Wysylki MSG_ZEROCOPY jednego gniazda, ktorych jadro jeszcze nie zwolnilo:
+// do powiadomienia czyta dane prosto ze stron ring (takze przy retransmisji),
+// wiec tych zakresow nie wolno nadpisac. Jadro numeruje udane wysylki
+// z MSG_ZEROCOPY kolejno od 0.
+//
+// sent/completed tylko watek wysylajacy; oldest() z dowolnego watku.
+class ZeroCopyTracker {
+public:
+    static constexpr uint64_t NONE = UINT64_MAX;
+
+    // Udana wysylka z MSG_ZEROCOPY danych od ring_begin.
+    void sent(uint64_t ring_begin);
+    // Powiadomienie jadra: wysylki lo..hi zakonczone.
+    void completed(uint32_t lo, uint32_t hi);
+    // Poczatek najstarszego zakresu w locie (pozycja w ring); NONE = nic w locie.
+    uint64_t oldest() const { return oldest_begin.load(std::memory_order_acquire); }
+
+private:
+    struct Range {
+        uint32_t id;
+        uint64_t begin;
+    };
+    std::deque<Range> ranges;
+    uint32_t next_id = 0;
+    std::atomic<uint64_t> oldest_begin{NONE};
+};
+
+// Wlacza SO_ZEROCOPY; false = jadro nie wspiera, zostaje Writev.
+bool enableZeroCopy(int fd);
+
+// Odbiera powiadomienia o zakonczonych wysylkach MSG_ZEROCOPY z kolejki bledow gniazda.
+void reapZeroCopy(int fd, ZeroCopyTracker& inflight);
+
+// Wysyla ile sie da bez blokowania (gniazdo musi byc O_NONBLOCK).
+// inflight: wysylki w locie przy SendMode::ZeroCopy (nullptr = zwykla wysylka). syscalls (opcjonalnie) zlicza
+// wykonane sendmsg - do /stats.
+SendStatus flushPending(int fd, PendingSend& pending, const BroadcastRing& ring, SendMode mode,
+                        ZeroCopyTracker* inflight, std::atomic<uint64_t>* syscalls = nullptr);
+
+// Cala oczekujaca reszta jako iovec (prefix + zakres ring, maks. 3 wpisy) - dla
+// wysylki poza flushPending (io_uring). -1 = dane w ring juz nadpisane.
+int pendingIov(const PendingSend& pending, const BroadcastRing& ring, iovec* iov);
+
+// Zdejmuje n wyslanych bajtow z poczatku pending.
+void consumePending(PendingSend& pending, size_t n);
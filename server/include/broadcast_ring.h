@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <sys/uio.h>
+
+// Wspolny bufor kolowy PCM: zegar odtwarzania zapisuje dane raz,
+// kazdy sluchacz trzyma tylko wlasny kursor (przesuniecie od startu serwera).
+//
+// Czytelnicy nie biora blokady: do odczytu udostepniana jest tylko polowa
+// bufora za glowa, druga polowa to zapas, ktorego zapis nie moze dogonic
+// w trakcie jednego nieblokujacego send/writev.
+class BroadcastRing {
+public:
+    explicit BroadcastRing(size_t capacity);
+
+    void write(const uint8_t* data, size_t len);
+
+    uint64_t head() const { return written.load(std::memory_order_acquire); }
+    uint64_t oldest() const;   // najstarszy bajt w bezpiecznym oknie odczytu
+    size_t capacity() const { return buffer.size(); }
+    size_t window() const { return buffer.size() / 2; }
+
+    // Wypelnia iov (maks. 2 wpisy) dla zakresu [from, from + len).
+    // Zwraca liczbe wpisow albo -1, gdy zakres wypadl z okna lub jeszcze nie istnieje.
+    int spans(uint64_t from, size_t len, iovec* iov) const;
+
+private:
+    std::vector<uint8_t> buffer;
+    std::atomic<uint64_t> written{0};
+    std::mutex write_mutex;
+};
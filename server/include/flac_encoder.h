@@ -0,0 +1,30 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "pcm_convert.h"
+
+// Prosty koder FLAC (bezstratny) dla segmentow HLS: kanaly kodowane osobno,
+// stale predyktory rzedu 0-4 i kod Rice'a z jednym parametrem na podramke.
+// Bloki o zmiennej dlugosci (naglowek ramki niesie numer probki), wiec
+// segment moze konczyc sie krotszym blokiem. Tylko jeden watek naraz.
+class FlacEncoder {
+public:
+    // min_block/max_block: zakres dlugosci blokow (ramki PCM) do STREAMINFO.
+    FlacEncoder(const PcmFormat& format, unsigned min_block, unsigned max_block);
+
+    // Blok STREAMINFO (34 bajty, bez naglowka bloku metadanych).
+    std::string streamInfo() const;
+
+    // Jedna ramka FLAC z frames ramek PCM (przeplecione, little-endian, format.bits),
+    // dopisana do out. first_sample: numer pierwszej probki w strumieniu.
+    void encodeFrame(const uint8_t* pcm, size_t frames, uint64_t first_sample, std::string& out);
+
+private:
+    PcmFormat format;
+    unsigned min_block;
+    unsigned max_block;
+    std::vector<int32_t> samples;  // jeden kanal biezacego bloku
+    std::vector<int32_t> residual;
+};
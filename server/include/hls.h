@@ -0,0 +1,83 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "broadcast_ring.h"
+#include "flac_encoder.h"
+#include "pcm_convert.h"
+
+// Gotowy segment HLS: caly plik fMP4 (moof + mdat z ramkami FLAC) zlozony raz,
+// potem tylko czytany - ta sama pamiec idzie do kazdego klienta i kazdego cache.
+struct HlsSegment {
+    uint64_t sequence = 0;
+    double duration = 0.0;       // sekundy
+    bool discontinuity = false;  // przerwa w danych przed tym segmentem
+    std::string body;
+    std::string etag;
+};
+
+// Tnie strumien ciagly stacji (staly format) na segmenty o stalej dlugosci
+// i trzyma ostatnie `kept` w pamieci. Probki ida bezstratnie jako FLAC w fMP4
+// (RFC 8216 nie dopuszcza WAV); bloki FLAC sa kodowane na biezaco w feed(),
+// wiec koszt rozklada sie na kolejne ticki. Playlista live obejmuje najnowsze
+// `listed`; starsze zostaja jeszcze chwile dla klientow, ktore ich wlasnie
+// pobieraja. Numery segmentow zaczynaja sie od czasu startu, wiec po
+// restarcie serwera adresy nie powtarzaja sie w cache posrednikow.
+class HlsSegmenter {
+public:
+    static constexpr size_t FLAC_BLOCK_FRAMES = 4096;
+
+    HlsSegmenter(const PcmFormat& format, unsigned segment_ms, size_t listed, size_t kept);
+
+    // Dopisuje nowe dane z ring od ostatniego wywolania; tylko jeden watek (stacji).
+    void feed(const BroadcastRing& ring);
+
+    // nullptr, gdy segmentu jeszcze nie ma albo juz wypadl.
+    std::shared_ptr<const HlsSegment> segment(uint64_t sequence) const;
+    // nullptr, dopoki nie powstal pierwszy segment.
+    std::shared_ptr<const std::string> playlist() const;
+    // Segment inicjujacy (ftyp + moov z opisem strumienia FLAC); staly.
+    const std::string& initSegment() const { return init_segment; }
+    const std::string& initEtag() const { return init_etag; }
+
+    unsigned targetDuration() const { return target_duration; }
+    size_t segmentCount() const;
+
+private:
+    PcmFormat format;
+    size_t segment_frames;
+    size_t block_count;     // bloki FLAC w segmencie
+    size_t last_block;      // ramki ostatniego bloku (pozostale maja FLAC_BLOCK_FRAMES)
+    double segment_duration;
+    unsigned target_duration;
+    size_t listed;
+    size_t kept;
+    FlacEncoder encoder;
+    std::string init_segment;
+    std::string init_etag;
+
+    // tylko watek feed()
+    uint64_t cursor = 0;          // pozycja w ring
+    uint64_t next_sequence;
+    uint64_t discontinuities = 0; // przed najstarszym trzymanym segmentem
+    bool gap = false;
+    uint64_t encoded_frames = 0;  // numer probki w naglowkach ramek FLAC
+    std::string block;            // PCM biezacego bloku
+    size_t block_index = 0;       // blok w biezacym segmencie
+    std::string media;            // ramki FLAC biezacego segmentu
+    std::vector<uint32_t> frame_sizes;
+
+    size_t blockFrames(size_t index) const { return index + 1 < block_count ? FLAC_BLOCK_FRAMES : last_block; }
+    void restartSegment();
+
+    mutable std::mutex mutex;
+    std::deque<std::shared_ptr<const HlsSegment>> segments;
+    std::shared_ptr<const std::string> live_playlist;
+
+    void seal();
+    std::string buildPlaylist() const;
+};
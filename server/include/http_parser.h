@@ -0,0 +1,131 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+struct HttpHeader {
+    std::string_view name;
+    std::string_view value;
+};
+
+// Widok na jedno zapytanie; wszystkie string_view wskazuja do bufora polaczenia
+// i sa wazne do jego nastepnej modyfikacji.
+struct HttpRequest {
+    static constexpr size_t MAX_HEADERS = 32;
+
+    std::string_view method;
+    std::string_view target; // path + ?query
+    std::string_view path;
+    std::string_view query;
+    std::string_view body;
+    int version_minor = 1;   // HTTP/1.x
+    long content_length = -1;
+    bool keep_alive = true;
+
+    HttpHeader headers[MAX_HEADERS];
+    size_t header_count = 0;
+
+    // Wartosc naglowka (nazwa bez rozrozniania wielkosci liter), pusta gdy brak.
+    std::string_view header(std::string_view name) const;
+};
+
+// Przyrostowy parser HTTP/1.x. Kolejne wywolania parse() dostaja ten sam,
+// rosnacy bufor; juz sprawdzone linie nie sa skanowane ponownie. Stan trzymany
+// jest jako przesuniecia, wiec bufor moze byc realokowany miedzy wywolaniami.
+class HttpParser {
+public:
+    enum class Status { NeedMore, Complete, Error };
+
+    explicit HttpParser(size_t max_header_bytes = 16 * 1024, size_t max_body_bytes = 75 * 1024 * 1024);
+
+    Status parse(std::string_view buffer);
+
+    // Po Complete: zapytanie i liczba bajtow, ktore zajelo w buforze.
+    // Juz po naglowkach (headersComplete) request() ma wszystko poza body,
+    // a bodyOffset() wskazuje poczatek ciala - pozwala to strumieniowac duze ciala.
+    const HttpRequest& request() const { return req; }
+    size_t consumed() const { return consumed_bytes; }
+    bool headersComplete() const { return state == State::Body || state == State::Done; }
+    size_t bodyOffset() const { return body_start; }
+    // Po Error: kod odpowiedzi (400, 413, 431, 501).
+    int errorStatus() const { return error_status; }
+
+    // Przygotowanie do kolejnego zapytania (bufor przesuniety o consumed()).
+    void reset();
+
+private:
+    enum class State { RequestLine, Headers, Body, Done, Failed };
+
+    struct Span {
+        uint32_t off = 0;
+        uint32_t len = 0;
+    };
+
+    size_t max_header_bytes;
+    size_t max_body_bytes;
+
+    State state = State::RequestLine;
+    size_t scan = 0;         // skad wznowic skanowanie
+    size_t body_start = 0;
+    size_t consumed_bytes = 0;
+    int error_status = 0;
+
+    Span method, target;
+    Span names[HttpRequest::MAX_HEADERS];
+    Span values[HttpRequest::MAX_HEADERS];
+    size_t header_count = 0;
+    int version_minor = 1;
+    long content_length = -1;
+
+    HttpRequest req;
+
+    Status fail(int status);
+    bool parseRequestLine(std::string_view line, size_t line_off);
+    bool parseHeaderLine(std::string_view line, size_t line_off);
+    void buildRequest(std::string_view buffer);
+};
+
+// Pary klucz=wartosc z query albo ciala application/x-www-form-urlencoded,
+// rozbite raz; widoki wskazuja do zrodla (bez dekodowania %XX).
+class QueryParams {
+public:
+    static constexpr size_t MAX_PARAMS = 16;
+
+    QueryParams() = default;
+    explicit QueryParams(std::string_view source) { parse(source); }
+
+    // Dokleja pary z source; nadmiarowe ponad MAX_PARAMS sa pomijane.
+    void parse(std::string_view source);
+
+    // Pusta, gdy brak klucza (pierwsze wystapienie).
+    std::string_view get(std::string_view key) const;
+    bool has(std::string_view key) const;
+    // Liczba calkowita >= 0; fallback, gdy brak klucza albo wartosc nie jest liczba.
+    long getInt(std::string_view key, long fallback = -1) const;
+    // Liczba >= 0, takze ulamkowa ("12.5").
+    double getDouble(std::string_view key, double fallback = -1.0) const;
+
+private:
+    HttpHeader params[MAX_PARAMS];
+    size_t count = 0;
+};
+
+enum class RangeResult {
+    None,          // brak naglowka, inna jednostka, wiele zakresow albo bledna skladnia - ignorujemy
+    Satisfiable,   // first..last (wlacznie) w obrebie zasobu
+    Unsatisfiable, // 416
+};
+
+// Naglowek Range dla zasobu o dlugosci size; obslugiwany jest jeden zakres bajtow
+// (bytes=a-, bytes=a-b, bytes=-n).
+RangeResult parseByteRange(std::string_view range, uint64_t size, uint64_t& first, uint64_t& last);
+
+// Parametr boundary z naglowka Content-Type (bez cudzyslowow).
+std::string_view multipartBoundary(std::string_view content_type);
+
+// Czy Accept-Encoding dopuszcza dane kodowanie (q=0 oznacza odmowe); wpis
+// z nazwa kodowania wazy wiecej niz "*".
+bool acceptsEncoding(std::string_view accept_encoding, std::string_view coding);
+
+// Czy If-None-Match pasuje do etag (porownanie slabe, RFC 9110 13.1.2).
+bool etagMatches(std::string_view if_none_match, std::string_view etag);
@@ -0,0 +1,65 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Tekst statusu HTTP ("Not Found"); dla nieznanego kodu tekst ogolny dla klasy.
+const char* httpStatusText(int status);
+
+// JSON dopisywany prosto do bufora odpowiedzi - bez posrednich std::string.
+// Przecinki wstawiane sa automatycznie miedzy elementami.
+class JsonWriter {
+public:
+    explicit JsonWriter(std::string& out) : out(out) {}
+
+    JsonWriter& beginObject();
+    JsonWriter& endObject();
+    JsonWriter& beginArray();
+    JsonWriter& endArray();
+    JsonWriter& key(std::string_view name);
+
+    JsonWriter& value(std::string_view s);
+    JsonWriter& value(const char* s) { return value(std::string_view(s)); }
+    JsonWriter& value(int64_t v);
+    JsonWriter& value(uint64_t v);
+    JsonWriter& value(int v) { return value(static_cast<int64_t>(v)); }
+    JsonWriter& value(unsigned v) { return value(static_cast<uint64_t>(v)); }
+    JsonWriter& value(double v);
+
+    // key(name).value(v)
+    template <typename T>
+    JsonWriter& field(std::string_view name, const T& v) { return key(name).value(v); }
+
+private:
+    std::string& out;
+    bool need_comma = false;
+
+    void separator();
+};
+
+// Odpowiedz HTTP/1.1 w buforach wielokrotnego uzytku (pojemnosc zostaje miedzy
+// zapytaniami polaczenia keep-alive). Naglowek i cialo wysyla sie jednym
+// wywolaniem z dwoma iovec.
+class HttpResponse {
+public:
+    // Linia statusu; czysci poprzedni naglowek.
+    void start(int status);
+    void header(std::string_view name, std::string_view value);
+    void header(std::string_view name, uint64_t value);
+    // Naglowki Connection/Keep-Alive i pusta linia konczaca naglowek.
+    void endHeaders(bool keep_alive, int keepalive_timeout_s, int keepalive_remaining);
+
+    const std::string& head() const { return head_buf; }
+
+    // Cialo skladane w miejscu (np. przez JsonWriter); czysci poprzednie.
+    std::string& beginBody();
+    const std::string& body() const { return body_buf; }
+
+    // Po wyslaniu: wyjatkowo duze bufory nie zostaja przy polaczeniu.
+    void trim();
+
+private:
+    std::string head_buf;
+    std::string body_buf;
+};
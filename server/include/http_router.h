@@ -0,0 +1,83 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Trasa HTTP: metoda + sciezka -> handler.
+template <typename Handler>
+struct Route {
+    std::string_view method;
+    std::string_view path;
+    Handler handler{};
+};
+
+// FNV-1a po "METHOD path" z ziarnem.
+constexpr uint32_t routeHash(std::string_view method, std::string_view path, uint32_t seed) {
+    uint32_t h = 2166136261u ^ seed;
+    for (char c : method) {
+        h ^= static_cast<unsigned char>(c);
+        h *= 16777619u;
+    }
+    h ^= ' ';
+    h *= 16777619u;
+    for (char c : path) {
+        h ^= static_cast<unsigned char>(c);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// Tablica tras z doskonalym haszem liczonym w czasie kompilacji: ziarno jest
+// dobierane tak, zeby kazda trasa trafila do wlasnego slotu. Wyszukanie to
+// jeden hasz i jedno porownanie, niezaleznie od liczby tras.
+template <typename Handler, size_t N, size_t Slots = 64>
+class RouteTable {
+    static_assert((Slots & (Slots - 1)) == 0, "Slots must be a power of two");
+    static_assert(N < Slots && Slots <= 128, "route count does not fit the slot table");
+
+public:
+    constexpr explicit RouteTable(const Route<Handler> (&list)[N]) {
+        for (size_t i = 0; i < N; ++i)
+            routes[i] = list[i];
+        for (uint32_t s = 1; s < 4096; ++s) {
+            if (build(s)) {
+                seed = s;
+                return;
+            }
+        }
+    }
+
+    // false = nie znaleziono ziarna bez kolizji (sprawdzane static_assert)
+    constexpr bool perfect() const { return seed != 0; }
+
+    const Route<Handler>* find(std::string_view method, std::string_view path) const {
+        int8_t i = slots[routeHash(method, path, seed) & (Slots - 1)];
+        if (i < 0) return nullptr;
+        const Route<Handler>& r = routes[static_cast<size_t>(i)];
+        return r.method == method && r.path == path ? &r : nullptr;
+    }
+
+    // Sciezka znana, ale z inna metoda (405 zamiast 404); tylko na sciezce bledu.
+    bool hasPath(std::string_view path) const {
+        for (const auto& r : routes)
+            if (r.path == path) return true;
+        return false;
+    }
+
+private:
+    std::array<Route<Handler>, N> routes{};
+    std::array<int8_t, Slots> slots{};
+    uint32_t seed = 0;
+
+    constexpr bool build(uint32_t s) {
+        for (size_t i = 0; i < Slots; ++i)
+            slots[i] = -1;
+        for (size_t i = 0; i < N; ++i) {
+            int8_t& slot = slots[routeHash(routes[i].method, routes[i].path, s) & (Slots - 1)];
+            if (slot >= 0) return false;
+            slot = static_cast<int8_t>(i);
+        }
+        return true;
+    }
+};
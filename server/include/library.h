@@ -0,0 +1,78 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include "wav.h"
+
+// Utwory wspolne dla wszystkich stacji: ten sam plik w kilku kolejkach jest
+// mapowany raz. Wpis jest wazny, dopoki plik ma ten sam rozmiar, inode i mtime.
+// Powyzej max_bytes (mapowane probki) wypadaja najdawniej uzyte wpisy -
+// utwor, ktory wlasnie gra, zyje dalej dzieki shared_ptr stacji.
+class TrackCache {
+public:
+    explicit TrackCache(size_t max_bytes);
+
+    // std::runtime_error, gdy pliku nie da sie wczytac (jak loadWavFile).
+    std::shared_ptr<const WavFile> get(const std::string& path);
+
+    struct Stats {
+        size_t entries = 0;
+        size_t bytes = 0;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+    };
+    Stats stats() const;
+
+private:
+    struct Entry {
+        std::shared_ptr<const WavFile> wav;
+        off_t size = 0;
+        ino_t inode = 0;
+        timespec mtime{};
+        uint64_t last_used = 0;
+    };
+
+    size_t max_bytes;
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, Entry> entries;
+    size_t bytes = 0;
+    uint64_t use_clock = 0;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+
+    void evict();
+};
+
+// Lista plikow WAV w katalogach biblioteki (audio/, uploads/) wspolna dla
+// stacji. Katalog jest czytany ponownie tylko po zmianie jego mtime, sprawdzanej
+// najwyzej raz na `revalidate`.
+class LibraryIndex {
+public:
+    explicit LibraryIndex(std::chrono::milliseconds revalidate = std::chrono::seconds(1));
+
+    // Posortowane sciezki "dir/plik.wav"; pusta lista, gdy katalogu nie ma.
+    std::vector<std::string> list(const std::string& dir);
+
+    // Po zapisie do katalogu (upload) - nastepne list() czyta go od razu.
+    void invalidate(const std::string& dir);
+
+private:
+    struct Entry {
+        std::vector<std::string> files;
+        timespec mtime{};
+        std::chrono::steady_clock::time_point checked;
+        bool valid = false;
+    };
+
+    std::chrono::milliseconds revalidate;
+    std::mutex mutex;
+    std::unordered_map<std::string, Entry> entries;
+};
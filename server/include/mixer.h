@@ -0,0 +1,51 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "broadcast_ring.h"
+#include "pcm_convert.h"
+#include "track_stream.h"
+#include "wav.h"
+
+// Odtwarzacz jednego utworu stacji: bufor odczytu (TrackStream) i przeliczenie
+// probek na float w formacie strumienia. Stacja ma dwa - przy przejsciu miedzy
+// utworami graja oba naraz.
+//
+// open() i fill() tylko watek stacji (open, gdy deck nie gra); reszta tylko zegar.
+class Deck {
+public:
+    Deck(size_t block_bytes, size_t blocks);
+
+    // hold_frames: tyle ramek wyjscia deck moze oddac bez zapisu bajtow utworu
+    // do ring (render z native == nullptr), zanim zabraknie mu bufora.
+    void open(std::shared_ptr<const WavFile> wav, const PcmFormat& out, size_t hold_frames = 0);
+    void fill() { source.fill(); }
+
+    // Do frames ramek wyjscia w dst; mniej na koncu utworu albo gdy watek stacji
+    // nie zdazyl doczytac. Zuzyte bajty utworu (oryginalny format) trafiaja do
+    // native; nullptr = zostaja w buforze do flushHeld().
+    size_t render(float* dst, size_t frames, BroadcastRing* native);
+    // Zatrzymane bajty utworu do ring, w kolejnosci.
+    void flushHeld(BroadcastRing& ring);
+    // Utwor konczy sie w biezacym miejscu (/skip, koniec przejscia).
+    void stop();
+
+    bool finished() const { return pos >= end && converted_offset == converted.size(); }
+    // Ramki wyjscia do konca utworu (przy zmianie czestotliwosci w przyblizeniu).
+    uint64_t remainingFrames() const;
+    // Bajty utworu juz przeliczone.
+    size_t position() const { return pos; }
+    const std::shared_ptr<const WavFile>& track() const { return source.track(); }
+
+private:
+    TrackStream source;
+    PcmConverter converter;
+    std::vector<float> converted;  // przeliczone probki, jeszcze nie oddane
+    size_t converted_offset = 0;
+    size_t in_frame = 0;
+    size_t out_channels = 0;
+    size_t pos = 0;      // bajty utworu juz przeliczone
+    size_t written = 0;  // bajty utworu juz w ring sluchaczy
+    size_t end = 0;      // koniec utworu albo miejsce stop()
+};
@@ -0,0 +1,51 @@
+#pragma once
+#include <cstddef>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <string_view>
+
+// Strumieniowy parser multipart/form-data dla /upload. Dane podawane sa
+// porcjami prosto z gniazda; pierwsza czesc z filename= trafia od razu na dysk,
+// w pamieci zostaje tylko kilka bajtow na granicy porcji i naglowki czesci.
+class MultipartFileStream {
+public:
+    // pathFor(filename) zwraca sciezke docelowa albo "" aby odrzucic plik.
+    MultipartFileStream(std::string_view boundary, std::function<std::string(const std::string&)> pathFor);
+    ~MultipartFileStream();
+
+    bool feed(const char* data, size_t len);
+
+    // Po ostatniej porcji: true, jesli plik zostal w calosci zapisany pod path().
+    bool finish();
+
+    const std::string& path() const { return out_path; }
+    size_t bytesWritten() const { return written; }
+    const std::string& error() const { return error_text; }
+
+private:
+    enum class State { Skip, Data, AfterDelimiter, PartHeaders, Epilogue, Failed };
+
+    static constexpr size_t MAX_PART_HEADERS = 8 * 1024;
+
+    std::string delimiter; // \r\n--boundary
+    std::function<std::string(const std::string&)> path_for;
+
+    State state = State::Skip;
+    std::string carry;     // koncowka poprzedniej porcji, ktora moze byc poczatkiem delimitera
+    std::string headers;   // naglowki biezacej czesci / bajty po delimiterze
+    bool file_done = false;
+
+    std::ofstream out;
+    std::string out_path;
+    std::string tmp_path;
+    size_t written = 0;
+    std::string error_text;
+
+    bool fail(const std::string& why);
+    void emit(const char* data, size_t len);
+    size_t scanBody(const char* data, size_t len);
+    size_t scanAfterDelimiter(const char* data, size_t len);
+    size_t scanPartHeaders(const char* data, size_t len);
+    bool openPart();
+};
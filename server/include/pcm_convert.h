@@ -0,0 +1,82 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Format probek PCM: little-endian, ze znakiem, 16 albo 24 bity.
+struct PcmFormat {
+    int sample_rate = 0;
+    int channels = 0;
+    int bits = 0;
+
+    size_t frameSize() const { return static_cast<size_t>(channels * (bits / 8)); }
+    uint32_t byteRate() const { return static_cast<uint32_t>(sample_rate) * static_cast<uint32_t>(frameSize()); }
+    bool operator==(const PcmFormat& o) const {
+        return sample_rate == o.sample_rate && channels == o.channels && bits == o.bits;
+    }
+    bool operator!=(const PcmFormat& o) const { return !(*this == o); }
+};
+
+// Probki PCM (16 albo 24 bity) <-> float w [-1, 1). Przy zapisie wartosci
+// sa zaokraglane i obcinane do zakresu, wiec PCM -> float -> PCM nie zmienia probek.
+void pcmToFloat(const uint8_t* src, size_t samples, int bits, float* dst);
+void floatToPcm(const float* src, size_t samples, int bits, uint8_t* dst);
+
+// Wersje petli pcmToFloat (pcm_kernels.cpp). Najlepsza obslugiwana przez
+// procesor jest wybierana raz, przy starcie; PCM_SIMD=0 zostawia tylko skalarna.
+enum class PcmKernel {
+    Scalar,
+    Sse2,
+    Avx2,
+};
+PcmKernel pcmKernel();
+bool pcmKernelSupported(PcmKernel kernel);
+const char* pcmKernelName(PcmKernel kernel);
+// Konkretna wersja (benchmark); nieobslugiwana = skalarna.
+void pcmToFloat(const uint8_t* src, size_t samples, int bits, float* dst, PcmKernel kernel);
+
+// dst = a * gain_a + b * gain_b dla frames ramek (przeplecione kanaly);
+// wzmocnienia zmieniaja sie liniowo od *_from do *_to, raz na ramke, wiec
+// wszystkie kanaly ramki dostaja to samo. dst moze byc a albo b.
+void mixCrossfade(const float* a, const float* b, float* dst, size_t frames, size_t channels,
+                  float a_from, float a_to, float b_from, float b_to);
+void mixCrossfade(const float* a, const float* b, float* dst, size_t frames, size_t channels,
+                  float a_from, float a_to, float b_from, float b_to, PcmKernel kernel);
+
+// Przeksztalca kolejne bloki PCM utworu na probki float w stalym formacie
+// wyjsciowym: liczba kanalow (mono <-> wiele kanalow) i czestotliwosc
+// (interpolacja liniowa); glebia bitowa wyjscia liczy sie dopiero przy
+// floatToPcm. Stan interpolacji przechodzi miedzy blokami, wiec wynik jest
+// ciagly niezaleznie od tego, jak wejscie zostalo pociete. Przy tych samych
+// kanalach i czestotliwosci probki sa tylko zamieniane na float.
+class PcmConverter {
+public:
+    // Nowy utwor: format wejscia i wyjscia, stan interpolacji od zera.
+    void reset(const PcmFormat& in, const PcmFormat& out);
+
+    // Dopisuje do dst przeksztalcone ramki z [data, data + frames * in.frameSize()).
+    // Blok jest zamieniany na float naraz; bez alokacji, jesli dst ma zapas na
+    // maxOutputFrames(frames) ramek, a reserve() dostalo co najmniej frames.
+    void convert(const uint8_t* data, size_t frames, std::vector<float>& dst);
+    size_t maxOutputFrames(size_t frames) const { return static_cast<size_t>(frames / step) + 2; }
+    void reserve(size_t frames) { block.reserve(frames * static_cast<size_t>(in_fmt.channels)); }
+
+    const PcmFormat& input() const { return in_fmt; }
+
+    const PcmFormat& output() const { return out_fmt; }
+
+    // Ile bajtow wyjscia da caly utwor o in_bytes bajtach wejscia (w przyblizeniu ramki).
+    static uint64_t outputBytes(const PcmFormat& in, const PcmFormat& out, uint64_t in_bytes);
+
+private:
+    PcmFormat in_fmt;
+    PcmFormat out_fmt;
+    double step = 1.0;  // ramki wejscia na ramke wyjscia
+    double pos = 0.0;   // pozycja nastepnej ramki wyjscia w biezacym bloku; -1 = ostatnia ramka poprzedniego
+    std::vector<float> prev;  // ostatnia ramka poprzedniego bloku (juz w kanalach wyjscia)
+    std::vector<float> frame_a;
+    std::vector<float> frame_b;
+    std::vector<float> block;  // biezacy blok wejscia jako float (kanaly wejscia)
+
+    void readFrame(const float* p, float* dst) const;
+};
@@ -5,11 +5,202 @@
 #include <mutex>
 #include <atomic>
 #include <condition_variable>
+#include <chrono>
 #include <string>
 #include <cstdint>
+#include <memory>
+#include <unordered_map>
 #include <portaudio.h>
 #include "track.h"
 #include "wav.h"
+#include "worker_pool.h"
+#include "broadcast_ring.h"
+#include "audio_send.h"
+#include "http_parser.h"
+#include "http_response.h"
+#include "multipart.h"
+#include "pcm_convert.h"
+#include "library.h"
+#include "hls.h"
+#include "mixer.h"
+#include "static_assets.h"
+#if AUDIO_IO_URING
+#include "uring_send.h"
+#endif
+
+// Co zrobic ze sluchaczem, ktory zostal w tyle o wiecej niz max_lag.
+enum class LagPolicy {
+    SkipToLive,  // przeskok do biezacej pozycji nadawania
+    DropOldest,  // pominiecie tylko najstarszych danych ponad limit
+    Disconnect,  // zamkniecie polaczenia
+};
+
+// Ile razy zadzialala polityka dla spoznionych sluchaczy (/stats).
+struct LagCounters {
+    std::atomic<uint64_t> skipped_to_live{0};
+    std::atomic<uint64_t> dropped_oldest{0};
+    std::atomic<uint64_t> disconnected{0};
+    std::atomic<uint64_t> stalled{0};  // gniazdo nie przyjmowalo danych dluzej niz limit
+    std::atomic<uint64_t> zerocopy_expired{0}; // MSG_ZEROCOPY bez potwierdzenia, a ring juz go dogania
+};
+
+// Przygotowanie nastepnego utworu stacji: watek stacji otwiera go z
+// wyprzedzeniem (Ready), zegar zaczyna przejscie przed koncem biezacego
+// (Switching - oba utwory graja naraz), po przejsciu (Switched) watek stacji
+// oglasza zmiane i wraca do None.
+enum class NextTrack {
+    None,
+    Ready,
+    Switching,
+    Switched,
+};
+
+// Stacja (mount, /stations/<name>/...): wlasna kolejka, zegar odtwarzania
+// i bufory sluchaczy. Reaktory, pule watkow, cache utworow i indeks biblioteki
+// sa wspolne dla wszystkich stacji procesu.
+struct Station {
+    size_t index = 0;
+    std::string name;
+    // stacja 0 gra takze lokalnie (PortAudio wyznacza tempo), pozostale maja
+    // zegar programowy we wlasnym watku przypietym do rdzenia
+    bool local_output = false;
+
+    std::deque<Track> playlist;
+    std::mutex playlist_mutex;
+    std::atomic<unsigned> queue_version{0};
+    std::atomic<bool> skip_requested{false};
+
+    // lokalne wyjscie jest otwarte raz, w formacie strumienia ciaglego, i gra
+    // cisze, gdy nic nie gra; bez niego stacja ma zegar programowy
+    PaStream* audio_stream = nullptr;
+    std::thread clock_thread;
+    // zmieniany tylko pod playback_mutex (announceTrack); nigdy nullptr
+    std::shared_ptr<const WavFile> wav = std::make_shared<const WavFile>();
+    // dwa odtwarzacze; zegar czyta probki tylko z nich. Biezacy utwor to
+    // decks[active_deck], drugi trzyma nastepny (prefetch)
+    std::unique_ptr<Deck> decks[2];
+    std::atomic<int> active_deck{0};
+    std::atomic<NextTrack> next_state{NextTrack::None};
+    Track next_entry;                    // utwor w drugim decku (tylko watek stacji)
+    unsigned prefetched_version = 0;     // queue_version przy przygotowaniu
+    // miejsca przejscia w ring sluchaczy, oglaszane razem z nowym utworem
+    std::atomic<uint64_t> switch_broadcast_offset{0};
+    std::atomic<uint64_t> switch_stream_offset{0};
+    // trwajace przejscie i bufory miksu (tylko zegar), w ramkach strumienia
+    size_t fade_done = 0;
+    size_t fade_length = 0;
+    std::vector<float> mix_current;
+    std::vector<float> mix_next;
+    std::vector<uint8_t> mix_pcm;
+    std::string current_track_name;
+    std::atomic<size_t> current_position{0};
+    std::atomic<unsigned> track_generation{0};
+    std::shared_ptr<BroadcastRing> broadcast;
+    std::atomic<uint64_t> track_start_offset{0};
+    std::mutex playback_mutex;
+
+    // strumien ciagly (/stream): zmiksowane wyjscie stacji w jednym stalym
+    // formacie (przejscia miedzy utworami sa w nim slychac), we wlasnym ring
+    std::shared_ptr<BroadcastRing> stream_ring;
+    std::atomic<uint64_t> stream_track_start{0}; // pozycja w stream_ring, od ktorej gra biezacy utwor
+    // segmenty HLS ciete ze stream_ring (watek stacji)
+    std::unique_ptr<HlsSegmenter> hls;
+
+    // stan ostatnio wyslany do subskrybentow /events (tylko watek reaktora)
+    unsigned published_queue_version = 0;
+    unsigned published_generation = 0;
+    size_t published_position = 0;
+    std::chrono::steady_clock::time_point last_progress_event;
+    std::chrono::steady_clock::time_point last_event_sent;
+};
+
+// Sluchacz /audio obslugiwany przez reaktor zamiast osobnego watku.
+struct AudioListener {
+    int fd = -1;
+    Station* station = nullptr;
+    std::shared_ptr<BroadcastRing> ring;
+    uint64_t cursor = 0;      // pozycja w ring
+    uint64_t track_start = 0; // pozycja w ring, od ktorej zaczyna sie utwor
+    size_t track_size = 0;    // strumien konczy sie na track_start + track_size (Range moze go skrocic)
+    uint64_t delay = 0;       // zamierzone opoznienie wzgledem nadawania (?t=, Range), bajty
+    bool exact = false;       // Range: bajty musza byc ciagle, wiec zaleglosc = rozlaczenie
+    bool continuous = false;  // /stream: przechodzi przez zmiany utworow, konczy sie tylko z serwerem
+    size_t frame_size = 1;
+    size_t max_lag = 0;       // limit zaleglosci (bajty) - tyle najwyzej czeka na wyslanie
+    unsigned generation = 0;
+    int epoll_fd = -1;        // reaktor, w ktorym zarejestrowane jest gniazdo
+    SendMode mode = SendMode::Writev;
+    ZeroCopyTracker zerocopy; // wysylki MSG_ZEROCOPY w locie (SendMode::ZeroCopy)
+    PendingSend pending;     // ramki chunked + zakres PCM w ring
+    bool chunk_open = false; // ostatni chunk PCM czeka na zamykajace \r\n
+    bool finished = false;   // dopisano koncowy chunk 0\r\n\r\n
+    bool behind = false;     // po biezacym chunku zostaly jeszcze dane do wyslania
+    // ICY (Icy-MetaData: 1): blok metadanych co icy_metaint bajtow ciala
+    size_t icy_metaint = 0;      // 0 = bez metadanych
+    size_t icy_remaining = 0;    // bajty ciala do nastepnego bloku
+    unsigned icy_generation = 0; // utwor, ktorego tytul juz jest w kolejce albo wyslany
+    std::string icy_title;       // StreamTitle do najblizszego bloku; pusty = blok zerowy
+    std::atomic<bool> busy{false};
+    // od kiedy (ms, steady_clock) czeka na EPOLLOUT; 0 = nie czeka
+    std::atomic<int64_t> stalled_since{0};
+};
+
+#if AUDIO_IO_URING
+// Wysylka sluchacza w locie przez io_uring; msghdr i iovec musza zyc do wyniku.
+struct UringListenerSend {
+    std::shared_ptr<AudioListener> listener;
+    msghdr msg{};
+    iovec iov[3];
+};
+#endif
+
+// Subskrybent /events (Server-Sent Events).
+struct EventSubscriber {
+    int fd = -1;
+    Station* station = nullptr;
+    int epoll_fd = -1;
+    std::string out;
+    size_t out_offset = 0;
+    std::mutex out_mutex;
+    std::atomic<bool> busy{false};
+};
+
+// Polaczenie HTTP/1.1 z keep-alive; bufor in trzyma nieprzetworzone (potokowe) zapytania.
+struct HttpConnection {
+    int fd = -1;
+    int epoll_fd = -1; // reaktor, ktory przyjal polaczenie
+    std::string in;
+    size_t in_start = 0; // poczatek nieprzetworzonych danych w in
+    HttpParser parser;
+    HttpResponse response; // bufory odpowiedzi, wielokrotnego uzytku
+    std::unique_ptr<MultipartFileStream> upload; // trwajacy /upload
+    Station* upload_station = nullptr;           // kolejka, do ktorej trafi plik
+    size_t upload_remaining = 0;
+    int requests = 0;
+    bool keep_alive = false; // decyzja dla biezacej odpowiedzi
+    bool detached = false;   // gniazdo przejal streamHttpAudio
+    // odpowiedz, ktorej gniazdo nie przyjelo od razu - reszta czeka na EPOLLOUT
+    std::string out;                           // kopia naglowka (i ciala bez wlasciciela)
+    size_t out_offset = 0;
+    std::string_view out_body;                 // cialo bez kopiowania (np. segment HLS)
+    std::shared_ptr<const void> out_owner;     // trzyma out_body przy zyciu
+    bool close_after_send = false;
+    bool sending() const { return out_offset < out.size() || !out_body.empty(); }
+    std::chrono::steady_clock::time_point last_active;
+    std::atomic<bool> busy{false};
+};
+
+// Reaktor z wlasnym gniazdem nasluchujacym (SO_REUSEPORT) i wlasnym epoll.
+// Jadro rozklada nowe polaczenia miedzy gniazda, wiec przy fali ponownych
+// polaczen accept nie czeka w jednej kolejce.
+struct ReactorShard {
+    size_t index = 0;
+    int listen_fd = -1;
+    int epoll_fd = -1;
+    int wake_fd = -1;
+    std::atomic<uint64_t> accepted{0};
+    std::thread thread;
+};
 
 class Server {
 public:
@@ -22,43 +213,119 @@ public:
 private:
     int port;
     int server_socket;
-    int http_socket{-1};
+    // shard 0 obsluguje takze tick (sluchacze, /events, sprzatanie) i io_uring
+    std::vector<std::unique_ptr<ReactorShard>> shards;
+    int tick_fd{-1};
     std::atomic<bool> running{false};
 
+    // zapytania HTTP (sterowanie, /events) i sluchacze /audio maja osobne pule,
+    // zeby tysiace strumieni nie opoznialy /skip czy /queue/move
+    WorkerPool control_workers;
+    WorkerPool listener_workers;
+
+    // public/ w pamieci (index.html)
+    StaticAssetCache static_assets{"public"};
+
+    std::unordered_map<int, std::shared_ptr<HttpConnection>> connections;
+    std::mutex connections_mutex;
+    std::chrono::steady_clock::time_point last_idle_sweep;
+
+    std::unordered_map<int, std::shared_ptr<AudioListener>> listeners;
+    std::mutex listeners_mutex;
+    LagPolicy lag_policy;
+    LagCounters lag_counters;
+    std::atomic<uint64_t> send_syscalls{0}; // sendmsg / io_uring_enter dla sluchaczy (/stats)
+#if AUDIO_IO_URING
+    // tylko watek reaktora; nullptr = jadro bez io_uring, zostaje sciezka epoll
+    std::unique_ptr<UringSender> uring;
+    std::unordered_map<int, UringListenerSend> uring_sends;
+#endif
+
+    std::unordered_map<int, std::shared_ptr<EventSubscriber>> subscribers;
+    std::mutex subscribers_mutex;
+
     std::vector<int> clients;
     std::mutex clients_mutex;
 
-    std::deque<Track> playlist;
-    std::mutex playlist_mutex;
-
-    std::atomic<bool> skip_requested{false};
+    // stacja 0 obsluguje tez sciezki bez prefiksu /stations/<name>
+    std::vector<std::unique_ptr<Station>> stations;
     std::atomic<int> next_track_id{1};
-
-    PaStream* audio_stream = nullptr;
-    WavFile current_wav;
-    std::string current_track_name;
-    std::atomic<size_t> current_position{0};
-    std::mutex playback_mutex;
-    std::condition_variable playback_cv;
+    // staly format strumienia ciaglego, wspolny dla stacji
+    const PcmFormat stream_format;
+    TrackCache track_cache;
+    LibraryIndex library;
 
     // std::thread accept_thread; dead code
-    std::thread stream_thread;
-    std::thread http_thread;
 
     // void acceptLoop(); dead code
-    void streamingLoop();
-    void httpLoop();
+    void stationLoop(Station& station);
+    void prefetchNextTrack(Station& station);
+    void announceTrack(Station& station);
+    void httpLoop(ReactorShard& shard);
 
     // void setupSocket(); dead code
-    void setupHttpSocket();
-    WavFile loadWav(const std::string& filename);
+    int setupHttpSocket(bool reuse_port);
+    void setupEventLoop();
+    void acceptClients(ReactorShard& shard);
+    void pumpListeners();
+    void pumpListener(const std::shared_ptr<AudioListener>& listener);
+    bool prepareListener(AudioListener& listener);
+    void waitWritable(const std::shared_ptr<AudioListener>& listener);
+    void finishListenerRound(const std::shared_ptr<AudioListener>& listener);
+#if AUDIO_IO_URING
+    void queueUringSend(const std::shared_ptr<AudioListener>& listener);
+    void submitUringSends();
+    void reapUringSends();
+#endif
+    void dropListener(int fd);
+    void closeConnection(int fd);
+    Station* resolveStation(std::string_view& path);
+    void subscribeEvents(HttpConnection& conn, Station& station);
+    void publishEvents();
+    void publishStationEvents(Station& station, std::chrono::steady_clock::time_point now);
+    void flushSubscriber(const std::shared_ptr<EventSubscriber>& sub);
+    void dropSubscriber(int fd);
+    void queueJson(JsonWriter& json, Station& station);
+    void statsJson(JsonWriter& json);
+    void progressJson(JsonWriter& json, Station& station);
+    void sweepIdleConnections();
     // void sendToClients(const uint8_t* buffer, size_t size); dead code
-    void handleHttpClient(int client);
-    void sendHttpResponse(int client, const std::string& body, const std::string& contentType = "text/plain", int status = 200);
-    int enqueueTrack(const std::string& filename);
-    void streamHttpAudio(int client);
-    void startAudioStream();
-    void stopAudioStream();
-
-    friend int portaudioCallback(const void*, void*, unsigned long, const PaStreamCallbackTimeInfo*, PaStreamCallbackFlags, void*);
+    void handleHttpClient(const std::shared_ptr<HttpConnection>& conn);
+    bool serveBufferedRequests(HttpConnection& conn);
+    void handleHttpRequest(HttpConnection& client, const HttpRequest& req);
+
+    // handlery tras (tablica w server.cpp, Server::Routes)
+    // station: wskazana w /stations/<name>/..., inaczej stacja 0
+    using RouteHandler = void (Server::*)(HttpConnection&, const HttpRequest&, const QueryParams&, Station&);
+    struct Routes;
+    void handleIndex(HttpConnection& client, const HttpRequest& req, const QueryParams& query, Station& station);
+    void handleLibrary(HttpConnection& client, const HttpRequest& req, const QueryParams& query, Station& station);
+    void handleProgress(HttpConnection& client, const HttpRequest& req, const QueryParams& query, Station& station);
+    void handleStats(HttpConnection& client, const HttpRequest& req, const QueryParams& query, Station& station);
+    void handleEvents(HttpConnection& client, const HttpRequest& req, const QueryParams& query, Station& station);
+    void handleSkip(HttpConnection& client, const HttpRequest& req, const QueryParams& query, Station& station);
+    void handleQueueList(HttpConnection& client, const HttpRequest& req, const QueryParams& query, Station& station);
+    void handleQueueAdd(HttpConnection& client, const HttpRequest& req, const QueryParams& query, Station& station);
+    void handleQueueMove(HttpConnection& client, const HttpRequest& req, const QueryParams& query, Station& station);
+    void handleQueueRemove(HttpConnection& client, const HttpRequest& req, const QueryParams& query, Station& station);
+    void handleStations(HttpConnection& client, const HttpRequest& req, const QueryParams& query, Station& station);
+    void handleAudio(HttpConnection& client, const HttpRequest& req, const QueryParams& query, Station& station);
+    void handleStream(HttpConnection& client, const HttpRequest& req, const QueryParams& query, Station& station);
+    void handleHlsPlaylist(HttpConnection& client, const HttpRequest& req, const QueryParams& query, Station& station);
+    void handleHlsInit(HttpConnection& client, const HttpRequest& req, const QueryParams& query, Station& station);
+    // /hls/<numer>.m4s - poza tablica tras, bo numer jest czescia sciezki
+    void handleHlsSegment(HttpConnection& client, const HttpRequest& req, std::string_view name, Station& station);
+    bool beginUpload(HttpConnection& conn, const HttpRequest& req);
+    void finishUpload(HttpConnection& conn);
+    void sendHttpResponse(HttpConnection& client, std::string_view body, std::string_view contentType = "text/plain", int status = 200);
+    void sendJson(HttpConnection& client, int status = 200);
+    // owner: wlasciciel ciala; gdy gniazdo jest pelne, reszta czeka na niego bez kopiowania
+    void sendPrepared(HttpConnection& client, std::string_view body, std::shared_ptr<const void> owner = nullptr);
+    bool flushResponse(HttpConnection& client);
+    void waitHttpEvent(HttpConnection& conn);
+    void sendStaticAsset(HttpConnection& client, const HttpRequest& request, const StaticAsset& asset);
+    int enqueueTrack(Station& station, const std::string& filename);
+    void streamHttpAudio(HttpConnection& client, const HttpRequest& req, const QueryParams& query, Station& station, bool continuous);
+    void startAudioStream(Station& station);
+    void stopAudioStream(Station& station);
 };
\ No newline at end of file
@@ -0,0 +1,53 @@
+#pragma once
+#include <chrono>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+// Plik z public/ zaladowany do pamieci. Odpowiedz to tylko wybor wariantu
+// i send - bez open/read przy kazdym zapytaniu.
+struct StaticAsset {
+    std::string content_type;
+    std::string body;
+    std::string etag;       // silny, z cudzyslowami, liczony z zawartosci
+    std::string gzip_body;  // puste, gdy brak wariantu gzip
+    std::string gzip_etag;  // liczony z gzip_body
+
+    // do wykrywania zmiany pliku na dysku
+    off_t size = 0;
+    ino_t inode = 0;
+    timespec mtime{};
+    // to samo dla gotowego <plik>.gz; gz_exists == false, gdy go nie bylo
+    bool gz_exists = false;
+    off_t gz_size = 0;
+    ino_t gz_inode = 0;
+    timespec gz_mtime{};
+};
+
+// Pamiec podreczna plikow statycznych. Plik jest sprawdzany (stat) najwyzej
+// raz na `revalidate` i ladowany ponownie tylko wtedy, gdy sie zmienil.
+class StaticAssetCache {
+public:
+    explicit StaticAssetCache(std::string root, std::chrono::milliseconds revalidate = std::chrono::seconds(1));
+
+    // name wzgledem katalogu root; nullptr, gdy pliku nie ma.
+    std::shared_ptr<const StaticAsset> get(const std::string& name);
+
+private:
+    struct Entry {
+        std::shared_ptr<const StaticAsset> asset;
+        std::chrono::steady_clock::time_point checked;
+    };
+
+    std::string root;
+    std::chrono::milliseconds revalidate;
+    std::mutex mutex;
+    std::unordered_map<std::string, Entry> entries;
+
+    std::shared_ptr<const StaticAsset> load(const std::string& path, const struct stat& st,
+                                            const struct stat* gz) const;
+};
@@ -0,0 +1,45 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "wav.h"
+
+// Biezacy utwor stacji czytany blokami przed kursorem odtwarzania do malego
+// bufora kolowego. Zegar (callback PortAudio albo zegar programowy) czyta
+// tylko z bufora, wiec nie czeka na dysk, a w pamieci procesu zostaje
+// najwyzej bufor i jeden blok mapowania - niezaleznie od dlugosci utworu.
+//
+// Jeden producent (watek stacji: open, fill) i jeden konsument (zegar: peek, consume).
+class TrackStream {
+public:
+    TrackStream(size_t block_bytes, size_t blocks);
+
+    // Nowy utwor od poczatku, od razu z pelnym buforem; tylko przy zatrzymanym zegarze.
+    // hold_bytes: dodatkowe miejsce na bajty przeczytane, ale jeszcze nie zwolnione
+    // przez consume() - tyle konsument moze trzymac bez zmniejszania wyprzedzenia.
+    void open(std::shared_ptr<const WavFile> wav, size_t hold_bytes = 0);
+    // Doczytuje cale bloki, az bufor jest pelny albo utwor sie skonczy.
+    void fill();
+
+    // Ciagly fragment utworu od pos, juz w buforze; len: najwyzej tyle (wejscie),
+    // faktycznie dostepne (wyjscie, 0 = producent nie zdazyl).
+    const uint8_t* peek(size_t pos, size_t& len) const;
+    // Bajty utworu przed pos nie beda juz czytane.
+    void consume(size_t pos) { consumed.store(pos, std::memory_order_release); }
+
+    size_t capacity() const { return ring_bytes; }
+    // Utwor z ostatniego open(); nullptr przed pierwszym.
+    const std::shared_ptr<const WavFile>& track() const { return wav; }
+
+private:
+    std::shared_ptr<const WavFile> wav;
+    std::vector<uint8_t> ring;
+    size_t block_bytes;
+    size_t read_ahead;      // bloki * block_bytes
+    size_t ring_bytes = 0;  // wielokrotnosc ramki utworu, zeby ramka nie dzielila sie na koncu bufora
+    size_t released = 0;    // strony mapowania przed ta pozycja sa juz oddane (tylko producent)
+    std::atomic<size_t> filled{0};   // koniec danych w buforze (bajty utworu)
+    std::atomic<size_t> consumed{0};
+};
@@ -0,0 +1,65 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <sys/socket.h>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+// Minimalny io_uring na surowych wywolaniach systemowych (bez liburing), tylko
+// do wysylki danych sluchaczy. Zgloszenia doklejane sa przez caly tick i ida
+// do jadra jednym io_uring_enter. Jeden producent i jeden konsument - watek
+// reaktora - wiec wystarcza bariery acquire/release na indeksach kolejek.
+class UringSender {
+public:
+    explicit UringSender(unsigned entries);
+    ~UringSender();
+
+    UringSender(const UringSender&) = delete;
+    UringSender& operator=(const UringSender&) = delete;
+
+    // false = jadro bez io_uring (albo wylaczone sysctl) - zostaje sciezka epoll.
+    bool ok() const { return ring_fd >= 0; }
+
+    // eventfd sygnalizowany po kazdym zakonczonym zgloszeniu (do epoll reaktora).
+    int eventFd() const { return event_fd; }
+
+    // Dokleja SENDMSG; msg (i jego iovec) musi zyc do odebrania wyniku.
+    // false = kolejka zgloszen pelna, trzeba najpierw submit().
+    bool sendmsg(int fd, const msghdr* msg, int flags, uint64_t user_data);
+
+    // Przekazuje doklejone zgloszenia jednym io_uring_enter; liczba przyjetych albo -1.
+    int submit();
+
+    // Kolejny wynik: user_data i res (bajty albo -errno); false = brak wynikow.
+    bool popCompletion(uint64_t& user_data, int& res);
+
+    uint64_t enterCalls() const { return enter_calls; }
+
+private:
+    int ring_fd = -1;
+    int event_fd = -1;
+
+    void* sq_ptr = nullptr;
+    void* cq_ptr = nullptr;
+    size_t sq_ring_bytes = 0;
+    size_t cq_ring_bytes = 0;
+    io_uring_sqe* sqes = nullptr;
+    size_t sqes_bytes = 0;
+
+    unsigned* sq_head = nullptr;
+    unsigned* sq_tail = nullptr;
+    unsigned* sq_array = nullptr;
+    unsigned sq_mask = 0;
+    unsigned sq_entries = 0;
+
+    unsigned* cq_head = nullptr;
+    unsigned* cq_tail = nullptr;
+    io_uring_cqe* cqes = nullptr;
+    unsigned cq_mask = 0;
+
+    unsigned pending_submit = 0;
+    uint64_t enter_calls = 0;
+
+    void release();
+};
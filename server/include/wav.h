@@ -1,12 +1,47 @@
 #pragma once
+#include <cstddef>
 #include <cstdint>
-#include <vector>
+#include <memory>
 #include <string>
 
+// Probki PCM jako widok na mapowanie pliku (tylko do odczytu). Kopie dziela
+// jedno mapowanie, ktore znika razem z ostatnia z nich.
+class PcmData {
+public:
+	PcmData() = default;
+	PcmData(std::shared_ptr<const void> owner, const uint8_t* ptr, size_t len)
+		: owner(std::move(owner)), ptr(ptr), len(len) {}
+
+	const uint8_t* data() const { return ptr; }
+	size_t size() const { return len; }
+	bool empty() const { return len == 0; }
+
+	// Podpowiedzi dla jadra (madvise) dla [offset, offset + count):
+	// prefetch - czytaj z wyprzedzeniem w tle, release - strony nie sa juz
+	// potrzebne (przy nastepnym dostepie wroca z page cache).
+	void prefetch(size_t offset, size_t count) const;
+	void release(size_t offset, size_t count) const;
+
+private:
+	std::shared_ptr<const void> owner;
+	const uint8_t* ptr = nullptr;
+	size_t len = 0;
+};
+
 struct WavFile {
 	int sampleRate = 0;
 	int channels = 0;
 	int bitsPerSample = 0;
-	std::vector<uint8_t> data;
+	PcmData data;
 };
 
+// Naglowek RIFF/WAVE i probki PCM (16/24 bit) z pliku; std::runtime_error przy bledzie.
+// Plik jest mapowany (mmap), nie kopiowany: start utworu nie czeka na odczyt,
+// a ten sam plik na kilku stacjach to te same strony page cache.
+WavFile loadWavFile(const std::string& filename);
+
+// Dlugosc naglowka WAV (RIFF + fmt + data) przed probkami.
+constexpr uint64_t WAV_HEADER_BYTES = 44;
+
+// Naglowek PCM w dst[0, WAV_HEADER_BYTES); data_size 0xFFFFFFFF = strumien bez konca.
+void writeWavHeader(uint8_t* dst, int sample_rate, int channels, int bits, uint32_t data_size);
@@ -0,0 +1,33 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <string>
+
+// Stala pula watkow obslugujaca zadania zlecane przez reaktor (httpLoop).
+// name trafia do nazw watkow (name-0, name-1, ...), nice_delta zmienia
+// priorytet watkow puli wzgledem reszty procesu (tylko w gore bez uprawnien).
+class WorkerPool {
+public:
+    explicit WorkerPool(size_t threads, std::string name = "worker", int nice_delta = 0);
+    ~WorkerPool();
+
+    void submit(std::function<void()> task);
+    void stop();
+
+    size_t size() const { return workers.size(); }
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex tasks_mutex;
+    std::condition_variable tasks_cv;
+    bool stopping = false;
+    std::string name;
+    int nice_delta;
+
+    void workerLoop(size_t index);
+};
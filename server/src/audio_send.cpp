@@ -0,0 +1,124 @@
+#include "audio_send.h"
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <linux/errqueue.h>
+#include <sys/socket.h>
+
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60
+#endif
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
+
+bool enableZeroCopy(int fd) {
+    int one = 1;
+    return setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) == 0;
+}
+
+void ZeroCopyTracker::sent(uint64_t ring_begin) {
+    ranges.push_back({next_id++, ring_begin});
+    if (ranges.size() == 1)
+        oldest_begin.store(ring_begin, std::memory_order_release);
+}
+
+void ZeroCopyTracker::completed(uint32_t lo, uint32_t hi) {
+    // numery moga sie przekrecic - porownanie wzgledem lo
+    const uint32_t span = hi - lo;
+    ranges.erase(std::remove_if(ranges.begin(), ranges.end(),
+                                [&](const Range& r) { return static_cast<uint32_t>(r.id - lo) <= span; }),
+                 ranges.end());
+    // zakresy ida w kolejnosci wysylki, wiec pierwszy jest najstarszy
+    oldest_begin.store(ranges.empty() ? NONE : ranges.front().begin, std::memory_order_release);
+}
+
+void reapZeroCopy(int fd, ZeroCopyTracker& inflight) {
+    char control[128];
+    while (true) {
+        msghdr msg{};
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        if (recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+            return;
+        for (cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+            if (cm->cmsg_len < CMSG_LEN(sizeof(sock_extended_err))) continue;
+            sock_extended_err err;
+            std::memcpy(&err, CMSG_DATA(cm), sizeof(err));
+            if (err.ee_origin == SO_EE_ORIGIN_ZEROCOPY && err.ee_errno == 0)
+                inflight.completed(err.ee_info, err.ee_data);
+        }
+    }
+}
+
+void consumePending(PendingSend& p, size_t n) {
+    size_t from_prefix = std::min(n, p.prefix.size() - p.prefix_offset);
+    p.prefix_offset += from_prefix;
+    p.data_begin += n - from_prefix;
+}
+
+int pendingIov(const PendingSend& p, const BroadcastRing& ring, iovec* iov) {
+    int cnt = 0;
+    if (p.prefix_offset < p.prefix.size()) {
+        iov[cnt].iov_base = const_cast<char*>(p.prefix.data() + p.prefix_offset);
+        iov[cnt].iov_len = p.prefix.size() - p.prefix_offset;
+        ++cnt;
+    }
+    int n = ring.spans(p.data_begin, static_cast<size_t>(p.data_end - p.data_begin), iov + cnt);
+    if (n < 0) return -1;
+    return cnt + n;
+}
+
+SendStatus flushPending(int fd, PendingSend& p, const BroadcastRing& ring, SendMode mode,
+                        ZeroCopyTracker* inflight, std::atomic<uint64_t>* syscalls) {
+    if (!inflight)
+        mode = SendMode::Writev;
+    if (mode == SendMode::ZeroCopy)
+        reapZeroCopy(fd, *inflight);
+
+    while (!p.empty()) {
+        size_t data_len = static_cast<size_t>(p.data_end - p.data_begin);
+        bool zerocopy = mode == SendMode::ZeroCopy && data_len >= ZEROCOPY_MIN_BYTES;
+
+        iovec iov[3];
+        int cnt = 0;
+        // przy MSG_ZEROCOPY jadro czyta strony pozniej, wiec prefix (zmienny string) idzie osobno
+        if (p.prefix_offset < p.prefix.size()) {
+            iov[cnt].iov_base = const_cast<char*>(p.prefix.data() + p.prefix_offset);
+            iov[cnt].iov_len = p.prefix.size() - p.prefix_offset;
+            ++cnt;
+        }
+        if (!(zerocopy && cnt)) {
+            int n = ring.spans(p.data_begin, data_len, iov + cnt);
+            if (n < 0) return SendStatus::Error; // dane nadpisane w trakcie oczekiwania
+            cnt += n;
+        }
+
+        msghdr msg{};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = static_cast<size_t>(cnt);
+        int flags = MSG_NOSIGNAL | MSG_DONTWAIT;
+        if (zerocopy && p.prefix_offset == p.prefix.size())
+            flags |= MSG_ZEROCOPY;
+        else if (zerocopy)
+            flags |= MSG_MORE;
+
+        ssize_t s = sendmsg(fd, &msg, flags);
+        if (syscalls) syscalls->fetch_add(1, std::memory_order_relaxed);
+        if (s > 0) {
+            if (flags & MSG_ZEROCOPY)
+                inflight->sent(p.data_begin);
+            consumePending(p, static_cast<size_t>(s));
+            continue;
+        }
+        if (s < 0 && errno == EINTR) continue;
+        if (s < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return SendStatus::WouldBlock;
+        if (s < 0 && errno == ENOBUFS && (flags & MSG_ZEROCOPY)) {
+            // limit optmem na powiadomienia - ta porcja idzie zwykla sciezka
+            mode = SendMode::Writev;
+            continue;
+        }
+        return SendStatus::Error;
+    }
+    return SendStatus::Done;
+}
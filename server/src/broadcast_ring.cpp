@@ -0,0 +1,43 @@
+#include "broadcast_ring.h"
+#include <algorithm>
+#include <cstring>
+
+BroadcastRing::BroadcastRing(size_t capacity) : buffer(capacity > 1 ? capacity : 2) {}
+
+void BroadcastRing::write(const uint8_t* data, size_t len) {
+    std::lock_guard<std::mutex> lock(write_mutex);
+    uint64_t pos = written.load(std::memory_order_relaxed);
+    // wiekszy zapis niz okno - zostaje tylko koncowka
+    if (len > window()) {
+        pos += len - window();
+        data += len - window();
+        len = window();
+    }
+    size_t start = static_cast<size_t>(pos % buffer.size());
+    size_t first = std::min(len, buffer.size() - start);
+    std::memcpy(buffer.data() + start, data, first);
+    std::memcpy(buffer.data(), data + first, len - first);
+    written.store(pos + len, std::memory_order_release);
+}
+
+uint64_t BroadcastRing::oldest() const {
+    uint64_t h = head();
+    return h > window() ? h - window() : 0;
+}
+
+int BroadcastRing::spans(uint64_t from, size_t len, iovec* iov) const {
+    uint64_t h = head();
+    if (from + len > h || from + window() < h)
+        return -1;
+    if (len == 0)
+        return 0;
+    size_t start = static_cast<size_t>(from % buffer.size());
+    size_t first = std::min(len, buffer.size() - start);
+    iov[0].iov_base = const_cast<uint8_t*>(buffer.data() + start);
+    iov[0].iov_len = first;
+    if (first == len)
+        return 1;
+    iov[1].iov_base = const_cast<uint8_t*>(buffer.data());
+    iov[1].iov_len = len - first;
+    return 2;
+}
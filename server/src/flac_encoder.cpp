@@ -0,0 +1,252 @@
+#include "flac_encoder.h"
+#include <algorithm>
+#include <cstdlib>
+
+namespace {
+
+// Zapis bitow od najstarszego, jak w strumieniu FLAC.
+class BitWriter {
+public:
+    explicit BitWriter(std::string& out) : out(out) {}
+
+    // bits <= 32
+    void put(uint32_t value, unsigned bits) {
+        if (bits == 0) return;
+        acc = (acc << bits) | (value & (0xFFFFFFFFu >> (32 - bits)));
+        pending += bits;
+        while (pending >= 8) {
+            pending -= 8;
+            out.push_back(static_cast<char>(acc >> pending));
+        }
+    }
+
+    // zeros zer i jedynka
+    void unary(uint32_t zeros) {
+        for (; zeros >= 32; zeros -= 32) put(0, 32);
+        put(1, zeros + 1);
+    }
+
+    void rice(uint32_t value, unsigned k) {
+        const uint32_t q = value >> k;
+        if (q + 1 + k <= 32) {
+            put((1u << k) | (value & ((1u << k) - 1)), q + 1 + k);
+        } else {
+            unary(q);
+            put(value, k);
+        }
+    }
+
+    void align() {
+        if (pending) put(0, 8 - pending);
+    }
+
+private:
+    std::string& out;
+    uint64_t acc = 0;
+    unsigned pending = 0;
+};
+
+struct CrcTables {
+    uint8_t crc8[256];
+    uint16_t crc16[256];
+    CrcTables() {
+        for (unsigned i = 0; i < 256; ++i) {
+            unsigned c8 = i;
+            unsigned c16 = i << 8;
+            for (int b = 0; b < 8; ++b) {
+                c8 = (c8 & 0x80) ? (c8 << 1) ^ 0x07 : c8 << 1;
+                c16 = (c16 & 0x8000) ? (c16 << 1) ^ 0x8005 : c16 << 1;
+            }
+            crc8[i] = static_cast<uint8_t>(c8);
+            crc16[i] = static_cast<uint16_t>(c16);
+        }
+    }
+};
+
+const CrcTables crc_tables;
+
+uint8_t crc8(const char* p, size_t len) {
+    uint8_t crc = 0;
+    for (size_t i = 0; i < len; ++i)
+        crc = crc_tables.crc8[crc ^ static_cast<uint8_t>(p[i])];
+    return crc;
+}
+
+uint16_t crc16(const char* p, size_t len) {
+    uint16_t crc = 0;
+    for (size_t i = 0; i < len; ++i)
+        crc = static_cast<uint16_t>((crc << 8) ^ crc_tables.crc16[(crc >> 8) ^ static_cast<uint8_t>(p[i])]);
+    return crc;
+}
+
+// kody z naglowka ramki; 0 = wartosc z STREAMINFO
+unsigned sampleRateCode(int rate) {
+    switch (rate) {
+    case 88200: return 1;
+    case 176400: return 2;
+    case 192000: return 3;
+    case 8000: return 4;
+    case 16000: return 5;
+    case 22050: return 6;
+    case 24000: return 7;
+    case 32000: return 8;
+    case 44100: return 9;
+    case 48000: return 10;
+    case 96000: return 11;
+    default: return 0;
+    }
+}
+
+unsigned sampleSizeCode(int bits) {
+    switch (bits) {
+    case 8: return 1;
+    case 12: return 2;
+    case 16: return 4;
+    case 20: return 5;
+    case 24: return 6;
+    default: return 0;
+    }
+}
+
+// numer probki w kodowaniu "UTF-8" (do 36 bitow)
+void putUtf8(std::string& out, uint64_t v) {
+    if (v < 0x80) {
+        out.push_back(static_cast<char>(v));
+        return;
+    }
+    int extra = v < 0x800 ? 1 : v < 0x10000 ? 2 : v < 0x200000 ? 3 : v < 0x4000000 ? 4 : v < 0x80000000 ? 5 : 6;
+    const uint8_t lead_mask = static_cast<uint8_t>(0xFF00 >> (extra + 1));
+    out.push_back(static_cast<char>(lead_mask | (v >> (6 * extra))));
+    for (int i = extra - 1; i >= 0; --i)
+        out.push_back(static_cast<char>(0x80 | ((v >> (6 * i)) & 0x3F)));
+}
+
+// reszta predyktora stalego danego rzedu dla x[i]
+inline int32_t fixedResidual(const int32_t* x, size_t i, unsigned order) {
+    switch (order) {
+    case 0: return x[i];
+    case 1: return x[i] - x[i - 1];
+    case 2: return x[i] - 2 * x[i - 1] + x[i - 2];
+    case 3: return x[i] - 3 * x[i - 1] + 3 * x[i - 2] - x[i - 3];
+    default: return x[i] - 4 * x[i - 1] + 6 * x[i - 2] - 4 * x[i - 3] + x[i - 4];
+    }
+}
+
+inline uint32_t zigzag(int32_t r) {
+    return (static_cast<uint32_t>(r) << 1) ^ static_cast<uint32_t>(r >> 31);
+}
+
+} // namespace
+
+FlacEncoder::FlacEncoder(const PcmFormat& format, unsigned min_block, unsigned max_block)
+    : format(format), min_block(min_block), max_block(max_block) {
+    samples.reserve(max_block);
+    residual.reserve(max_block);
+}
+
+std::string FlacEncoder::streamInfo() const {
+    std::string out;
+    BitWriter w(out);
+    w.put(min_block, 16);
+    w.put(max_block, 16);
+    w.put(0, 24); // najmniejsza / najwieksza ramka: nieznane
+    w.put(0, 24);
+    w.put(static_cast<uint32_t>(format.sample_rate), 20);
+    w.put(static_cast<uint32_t>(format.channels - 1), 3);
+    w.put(static_cast<uint32_t>(format.bits - 1), 5);
+    w.put(0, 4); // liczba probek: strumien bez konca
+    w.put(0, 32);
+    out.append(16, '\0'); // MD5: nie liczone
+    return out;
+}
+
+void FlacEncoder::encodeFrame(const uint8_t* pcm, size_t frames, uint64_t first_sample, std::string& out) {
+    const size_t start = out.size();
+    const unsigned bps = static_cast<unsigned>(format.bits);
+    const size_t sample_bytes = static_cast<size_t>(format.bits / 8);
+    const size_t channels = static_cast<size_t>(format.channels);
+
+    BitWriter w(out);
+    w.put(0xFFF9, 16); // synchronizacja, bloki o zmiennej dlugosci
+    w.put(7, 4);       // dlugosc bloku: 16 bitow po numerze probki
+    w.put(sampleRateCode(format.sample_rate), 4);
+    w.put(static_cast<uint32_t>(channels - 1), 4);
+    w.put(sampleSizeCode(format.bits), 3);
+    w.put(0, 1);
+    putUtf8(out, first_sample & ((uint64_t(1) << 36) - 1));
+    w.put(static_cast<uint32_t>(frames - 1), 16);
+    out.push_back(static_cast<char>(crc8(out.data() + start, out.size() - start)));
+
+    samples.resize(frames);
+    residual.resize(frames);
+    for (size_t ch = 0; ch < channels; ++ch) {
+        const uint8_t* p = pcm + ch * sample_bytes;
+        const size_t stride = channels * sample_bytes;
+        if (sample_bytes == 3) {
+            for (size_t i = 0; i < frames; ++i, p += stride)
+                samples[i] = static_cast<int32_t>((uint32_t(p[0]) << 8) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 24)) >> 8;
+        } else {
+            for (size_t i = 0; i < frames; ++i, p += stride)
+                samples[i] = static_cast<int16_t>(p[0] | (p[1] << 8));
+        }
+        const int32_t* x = samples.data();
+
+        if (std::all_of(samples.begin(), samples.end(), [&](int32_t s) { return s == x[0]; })) {
+            w.put(0x00, 8); // podramka stala (cisza)
+            w.put(static_cast<uint32_t>(x[0]), bps);
+            continue;
+        }
+
+        // rzad predyktora o najmniejszej sumie |reszt|
+        unsigned order = 0;
+        if (frames > 4) {
+            uint64_t err[5] = {};
+            for (size_t i = 4; i < frames; ++i)
+                for (unsigned o = 0; o < 5; ++o)
+                    err[o] += static_cast<uint64_t>(std::abs(static_cast<int64_t>(fixedResidual(x, i, o))));
+            order = static_cast<unsigned>(std::min_element(err, err + 5) - err);
+        }
+
+        const size_t count = frames - order;
+        uint64_t sum = 0;
+        for (size_t i = order; i < frames; ++i) {
+            residual[i] = fixedResidual(x, i, order);
+            sum += zigzag(residual[i]);
+        }
+        // parametr Rice'a: okolice log2 sredniej, potem dokladny koszt sasiadow
+        unsigned guess = 0;
+        while (guess < 30 && (uint64_t(count) << (guess + 1)) <= sum) ++guess;
+        unsigned best_k = guess;
+        uint64_t best_bits = UINT64_MAX;
+        for (unsigned k = guess > 0 ? guess - 1 : 0; k <= std::min(guess + 1, 30u); ++k) {
+            uint64_t bits = uint64_t(count) * (k + 1);
+            for (size_t i = order; i < frames; ++i) bits += zigzag(residual[i]) >> k;
+            if (bits < best_bits) {
+                best_bits = bits;
+                best_k = k;
+            }
+        }
+
+        const unsigned param_bits = best_k > 14 ? 5 : 4;
+        if (uint64_t(order) * bps + 2 + 4 + param_bits + best_bits >= uint64_t(frames) * bps) {
+            w.put(0x02, 8); // podramka doslowna
+            for (size_t i = 0; i < frames; ++i)
+                w.put(static_cast<uint32_t>(x[i]), bps);
+            continue;
+        }
+
+        w.put((0x08 | order) << 1, 8); // predyktor staly
+        for (size_t i = 0; i < order; ++i)
+            w.put(static_cast<uint32_t>(x[i]), bps);
+        w.put(param_bits == 5 ? 1 : 0, 2); // metoda kodowania reszt
+        w.put(0, 4);                       // jedna partycja
+        w.put(best_k, param_bits);
+        for (size_t i = order; i < frames; ++i)
+            w.rice(zigzag(residual[i]), best_k);
+    }
+
+    w.align();
+    const uint16_t crc = crc16(out.data() + start, out.size() - start);
+    out.push_back(static_cast<char>(crc >> 8));
+    out.push_back(static_cast<char>(crc & 0xFF));
+}
@@ -0,0 +1,331 @@
+#include "hls.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+namespace {
+
+// FLAC: blok ma najmniej 16 ramek; krotsza koncowka segmentu dolacza do ostatniego pelnego bloku
+constexpr size_t FLAC_MIN_BLOCK_FRAMES = 16;
+
+size_t flacBlockCount(size_t segment_frames) {
+    const size_t full = segment_frames / HlsSegmenter::FLAC_BLOCK_FRAMES;
+    const size_t rest = segment_frames % HlsSegmenter::FLAC_BLOCK_FRAMES;
+    if (full == 0) return 1;
+    return rest == 0 || rest < FLAC_MIN_BLOCK_FRAMES ? full : full + 1;
+}
+
+// Pudelka ISO BMFF (MP4): rozmiar uzupelniany przy zamknieciu.
+class BoxWriter {
+public:
+    explicit BoxWriter(std::string& out) : out(out) {}
+
+    // version >= 0: FullBox (wersja + flagi)
+    void open(const char* type, int version = -1, uint32_t flags = 0) {
+        open_at.push_back(out.size());
+        u32(0);
+        out.append(type, 4);
+        if (version >= 0) {
+            u8(static_cast<uint8_t>(version));
+            u24(flags);
+        }
+    }
+    void close() {
+        patch32(open_at.back(), static_cast<uint32_t>(out.size() - open_at.back()));
+        open_at.pop_back();
+    }
+
+    void u8(uint8_t v) { out.push_back(static_cast<char>(v)); }
+    void u16(uint16_t v) { u8(static_cast<uint8_t>(v >> 8)); u8(static_cast<uint8_t>(v)); }
+    void u24(uint32_t v) { u8(static_cast<uint8_t>(v >> 16)); u16(static_cast<uint16_t>(v)); }
+    void u32(uint32_t v) { u16(static_cast<uint16_t>(v >> 16)); u16(static_cast<uint16_t>(v)); }
+    void u64(uint64_t v) { u32(static_cast<uint32_t>(v >> 32)); u32(static_cast<uint32_t>(v)); }
+    void fourcc(const char* v) { out.append(v, 4); }
+    void zeros(size_t n) { out.append(n, '\0'); }
+    void bytes(const std::string& v) { out += v; }
+    void matrix() {
+        // macierz jednostkowa (16.16, ostatni wiersz 2.30)
+        u32(0x00010000); u32(0); u32(0);
+        u32(0); u32(0x00010000); u32(0);
+        u32(0); u32(0); u32(0x40000000);
+    }
+    void patch32(size_t at, uint32_t v) {
+        for (int i = 0; i < 4; ++i)
+            out[at + i] = static_cast<char>(v >> (24 - 8 * i));
+    }
+
+private:
+    std::string& out;
+    std::vector<size_t> open_at;
+};
+
+// ftyp + moov: jedna sciezka audio 'fLaC', probki dopiero w segmentach (mvex)
+std::string buildInitSegment(const PcmFormat& format, const std::string& stream_info) {
+    const uint32_t rate = static_cast<uint32_t>(format.sample_rate);
+    std::string out;
+    BoxWriter b(out);
+    b.open("ftyp");
+    b.fourcc("iso6");
+    b.u32(0);
+    b.fourcc("iso6");
+    b.fourcc("mp41");
+    b.close();
+
+    b.open("moov");
+    b.open("mvhd", 0);
+    b.u32(0); b.u32(0); // czas utworzenia / zmiany
+    b.u32(rate);
+    b.u32(0); // dlugosc: strumien bez konca
+    b.u32(0x00010000); b.u16(0x0100); b.zeros(10);
+    b.matrix();
+    b.zeros(24);
+    b.u32(2); // next_track_ID
+    b.close();
+
+    b.open("trak");
+    b.open("tkhd", 0, 0x000003); // sciezka wlaczona, w prezentacji
+    b.u32(0); b.u32(0);
+    b.u32(1); // track_ID
+    b.u32(0);
+    b.u32(0);
+    b.zeros(8);
+    b.u16(0); b.u16(0); b.u16(0x0100); b.u16(0);
+    b.matrix();
+    b.u32(0); b.u32(0);
+    b.close();
+
+    b.open("mdia");
+    b.open("mdhd", 0);
+    b.u32(0); b.u32(0);
+    b.u32(rate); // skala czasu = czestotliwosc, wiec czas segmentu to liczba ramek
+    b.u32(0);
+    b.u16(0x55C4); // jezyk "und"
+    b.u16(0);
+    b.close();
+    b.open("hdlr", 0);
+    b.u32(0);
+    b.fourcc("soun");
+    b.zeros(12);
+    b.bytes("SoundHandler");
+    b.u8(0);
+    b.close();
+
+    b.open("minf");
+    b.open("smhd", 0);
+    b.u32(0);
+    b.close();
+    b.open("dinf");
+    b.open("dref", 0);
+    b.u32(1);
+    b.open("url ", 0, 1); // dane w tym samym pliku
+    b.close();
+    b.close();
+    b.close();
+
+    b.open("stbl");
+    b.open("stsd", 0);
+    b.u32(1);
+    b.open("fLaC");
+    b.zeros(6);
+    b.u16(1); // data_reference_index
+    b.zeros(8);
+    b.u16(static_cast<uint16_t>(format.channels));
+    b.u16(static_cast<uint16_t>(format.bits));
+    b.u32(0);
+    b.u32(rate <= 0xFFFF ? rate << 16 : 0);
+    b.open("dfLa", 0);
+    b.u8(0x80); // ostatni blok metadanych, STREAMINFO
+    b.u24(static_cast<uint32_t>(stream_info.size()));
+    b.bytes(stream_info);
+    b.close();
+    b.close();
+    b.close();
+    // tabele probek puste - opis probek jest w moof kazdego segmentu
+    b.open("stts", 0); b.u32(0); b.close();
+    b.open("stsc", 0); b.u32(0); b.close();
+    b.open("stsz", 0); b.u32(0); b.u32(0); b.close();
+    b.open("stco", 0); b.u32(0); b.close();
+    b.close(); // stbl
+    b.close(); // minf
+    b.close(); // mdia
+    b.close(); // trak
+
+    b.open("mvex");
+    b.open("trex", 0);
+    b.u32(1); b.u32(1); b.u32(0); b.u32(0); b.u32(0);
+    b.close();
+    b.close();
+    b.close(); // moov
+    return out;
+}
+
+} // namespace
+
+HlsSegmenter::HlsSegmenter(const PcmFormat& format, unsigned segment_ms, size_t listed, size_t kept)
+    : format(format),
+      segment_frames(std::max<uint64_t>(uint64_t(format.sample_rate) * segment_ms / 1000, FLAC_MIN_BLOCK_FRAMES)),
+      block_count(flacBlockCount(segment_frames)),
+      last_block(segment_frames - (block_count - 1) * FLAC_BLOCK_FRAMES),
+      segment_duration(static_cast<double>(segment_frames) / format.sample_rate),
+      target_duration(static_cast<unsigned>(std::ceil(segment_duration))),
+      listed(std::max<size_t>(listed, 1)),
+      kept(std::max(kept, std::max<size_t>(listed, 1))),
+      encoder(format,
+              static_cast<unsigned>(block_count > 1 ? std::min(FLAC_BLOCK_FRAMES, last_block) : last_block),
+              static_cast<unsigned>(block_count > 1 ? std::max(FLAC_BLOCK_FRAMES, last_block) : last_block)) {
+    init_segment = buildInitSegment(format, encoder.streamInfo());
+    // FNV-1a 64 - ten sam adres init.mp4 po zmianie formatu strumienia musi dac inny ETag
+    uint64_t h = 1469598103934665603ull;
+    for (unsigned char c : init_segment) {
+        h ^= c;
+        h *= 1099511628211ull;
+    }
+    char etag[24];
+    std::snprintf(etag, sizeof(etag), "\"%016llx\"", static_cast<unsigned long long>(h));
+    init_etag = etag;
+
+    const auto now = std::chrono::system_clock::now().time_since_epoch();
+    next_sequence = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(now).count())
+                    / std::max(segment_ms, 1u);
+    block.reserve(std::max(FLAC_BLOCK_FRAMES, last_block) * format.frameSize());
+    media.reserve(segment_frames * format.frameSize());
+    frame_sizes.reserve(block_count);
+}
+
+void HlsSegmenter::restartSegment() {
+    block.clear();
+    media.clear();
+    frame_sizes.clear();
+    block_index = 0;
+}
+
+void HlsSegmenter::feed(const BroadcastRing& ring) {
+    const uint64_t head = ring.head();
+    const size_t frame = format.frameSize();
+    if (cursor < ring.oldest()) {
+        // zegar stacji wyprzedzil segmenter o cale okno - zaczynamy od nowa w pelnej ramce
+        cursor = head - (head - ring.oldest()) / frame * frame;
+        restartSegment();
+        gap = true;
+    }
+
+    while (cursor < head) {
+        const size_t frames = blockFrames(block_index);
+        const size_t block_bytes = frames * frame;
+        size_t len = static_cast<size_t>(std::min<uint64_t>(head - cursor, block_bytes - block.size()));
+        iovec iov[2];
+        int n = ring.spans(cursor, len, iov);
+        if (n < 0) return;
+        for (int i = 0; i < n; ++i)
+            block.append(static_cast<const char*>(iov[i].iov_base), iov[i].iov_len);
+        cursor += len;
+        if (block.size() < block_bytes)
+            continue;
+
+        // pelny blok od razu do FLAC, zeby koszt kodowania nie spadal na jeden tick
+        const size_t before = media.size();
+        encoder.encodeFrame(reinterpret_cast<const uint8_t*>(block.data()), frames, encoded_frames, media);
+        frame_sizes.push_back(static_cast<uint32_t>(media.size() - before));
+        encoded_frames += frames;
+        block.clear();
+        if (++block_index == block_count)
+            seal();
+    }
+}
+
+void HlsSegmenter::seal() {
+    auto segment = std::make_shared<HlsSegment>();
+    segment->sequence = next_sequence++;
+    segment->duration = segment_duration;
+    segment->discontinuity = gap;
+    gap = false;
+
+    // moof (jedna ramka FLAC = jedna probka MP4) + mdat
+    std::string& body = segment->body;
+    body.reserve(media.size() + 128 + 8 * frame_sizes.size());
+    BoxWriter b(body);
+    b.open("moof");
+    b.open("mfhd", 0);
+    b.u32(static_cast<uint32_t>(segment->sequence));
+    b.close();
+    b.open("traf");
+    b.open("tfhd", 0, 0x020000); // default-base-is-moof
+    b.u32(1);
+    b.close();
+    b.open("tfdt", 1);
+    // czas z numeru segmentu: ciagly miedzy segmentami i po restarcie serwera
+    b.u64(segment->sequence * segment_frames);
+    b.close();
+    b.open("trun", 0, 0x000301); // data_offset, czas i rozmiar kazdej probki
+    b.u32(static_cast<uint32_t>(frame_sizes.size()));
+    const size_t data_offset_at = body.size();
+    b.u32(0);
+    for (size_t i = 0; i < frame_sizes.size(); ++i) {
+        b.u32(static_cast<uint32_t>(blockFrames(i)));
+        b.u32(frame_sizes[i]);
+    }
+    b.close();
+    b.close(); // traf
+    b.close(); // moof
+    b.patch32(data_offset_at, static_cast<uint32_t>(body.size() + 8));
+    b.open("mdat");
+    body += media;
+    b.close();
+    restartSegment();
+    // numer segmentu jednoznacznie wyznacza tresc
+    segment->etag = "\"" + std::to_string(segment->sequence) + "\"";
+
+    std::lock_guard<std::mutex> lock(mutex);
+    segments.push_back(std::move(segment));
+    while (segments.size() > kept) {
+        if (segments.front()->discontinuity) ++discontinuities;
+        segments.pop_front();
+    }
+    live_playlist = std::make_shared<const std::string>(buildPlaylist());
+}
+
+// wywolywane pod mutex
+std::string HlsSegmenter::buildPlaylist() const {
+    const size_t first = segments.size() > listed ? segments.size() - listed : 0;
+    uint64_t discontinuity_sequence = discontinuities;
+    for (size_t i = 0; i < first; ++i)
+        if (segments[i]->discontinuity) ++discontinuity_sequence;
+
+    // EXT-X-MAP (segmenty fMP4) wymaga wersji 6+
+    std::string out = "#EXTM3U\n#EXT-X-VERSION:7\n#EXT-X-INDEPENDENT-SEGMENTS\n";
+    out += "#EXT-X-TARGETDURATION:" + std::to_string(target_duration) + "\n";
+    out += "#EXT-X-MEDIA-SEQUENCE:" + std::to_string(segments[first]->sequence) + "\n";
+    if (discontinuity_sequence)
+        out += "#EXT-X-DISCONTINUITY-SEQUENCE:" + std::to_string(discontinuity_sequence) + "\n";
+    out += "#EXT-X-MAP:URI=\"init.mp4\"\n";
+    for (size_t i = first; i < segments.size(); ++i) {
+        const HlsSegment& s = *segments[i];
+        if (s.discontinuity)
+            out += "#EXT-X-DISCONTINUITY\n";
+        char extinf[48];
+        std::snprintf(extinf, sizeof(extinf), "#EXTINF:%.3f,\n", s.duration);
+        out += extinf;
+        // wzgledem playlisty, wiec dziala tez pod /stations/<name>/hls/
+        out += std::to_string(s.sequence) + ".m4s\n";
+    }
+    return out;
+}
+
+std::shared_ptr<const HlsSegment> HlsSegmenter::segment(uint64_t sequence) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (segments.empty() || sequence < segments.front()->sequence)
+        return nullptr;
+    uint64_t i = sequence - segments.front()->sequence;
+    return i < segments.size() ? segments[static_cast<size_t>(i)] : nullptr;
+}
+
+std::shared_ptr<const std::string> HlsSegmenter::playlist() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return live_playlist;
+}
+
+size_t HlsSegmenter::segmentCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return segments.size();
+}
@@ -0,0 +1,376 @@
+#include "http_parser.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <cctype>
+#include <limits>
+
+static char lower(char c) {
+    return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+}
+
+static bool iequals(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i)
+        if (lower(a[i]) != lower(b[i])) return false;
+    return true;
+}
+
+static std::string_view trimOws(std::string_view s) {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) s.remove_suffix(1);
+    return s;
+}
+
+// lista tokenow rozdzielonych przecinkami, np. "keep-alive, Upgrade"
+static bool hasToken(std::string_view list, std::string_view token) {
+    while (!list.empty()) {
+        size_t comma = list.find(',');
+        if (iequals(trimOws(list.substr(0, comma)), token)) return true;
+        if (comma == std::string_view::npos) break;
+        list.remove_prefix(comma + 1);
+    }
+    return false;
+}
+
+// znaki dozwolone w nazwach metod i naglowkow (RFC 9110 tchar)
+struct TcharTable {
+    bool allowed[256] = {};
+    constexpr TcharTable() {
+        for (int c = '0'; c <= '9'; ++c) allowed[c] = true;
+        for (int c = 'a'; c <= 'z'; ++c) allowed[c] = true;
+        for (int c = 'A'; c <= 'Z'; ++c) allowed[c] = true;
+        for (char c : std::string_view("!#$%&'*+-.^_`|~")) allowed[static_cast<unsigned char>(c)] = true;
+    }
+};
+static constexpr TcharTable kTchar{};
+
+static bool isTchar(char c) {
+    return kTchar.allowed[static_cast<unsigned char>(c)];
+}
+
+std::string_view HttpRequest::header(std::string_view name) const {
+    for (size_t i = 0; i < header_count; ++i)
+        if (iequals(headers[i].name, name)) return headers[i].value;
+    return {};
+}
+
+HttpParser::HttpParser(size_t max_header_bytes, size_t max_body_bytes)
+    : max_header_bytes(max_header_bytes), max_body_bytes(max_body_bytes) {}
+
+void HttpParser::reset() {
+    state = State::RequestLine;
+    scan = 0;
+    body_start = 0;
+    consumed_bytes = 0;
+    error_status = 0;
+    header_count = 0;
+    version_minor = 1;
+    content_length = -1;
+}
+
+HttpParser::Status HttpParser::fail(int status) {
+    state = State::Failed;
+    error_status = status;
+    return Status::Error;
+}
+
+HttpParser::Status HttpParser::parse(std::string_view buffer) {
+    if (state == State::Done) return Status::Complete;
+    if (state == State::Failed) return Status::Error;
+
+    while (state == State::RequestLine || state == State::Headers) {
+        const void* hit = scan < buffer.size()
+            ? std::memchr(buffer.data() + scan, '\n', buffer.size() - scan)
+            : nullptr;
+        if (!hit) {
+            if (buffer.size() > max_header_bytes) return fail(431);
+            return Status::NeedMore;
+        }
+
+        size_t nl = static_cast<size_t>(static_cast<const char*>(hit) - buffer.data());
+        if (nl >= max_header_bytes) return fail(431);
+
+        size_t line_off = scan;
+        std::string_view line = buffer.substr(line_off, nl - line_off);
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        scan = nl + 1;
+
+        if (state == State::RequestLine) {
+            if (line.empty()) continue; // RFC 9112: puste linie przed zapytaniem sa dozwolone
+            if (!parseRequestLine(line, line_off)) return fail(400);
+            state = State::Headers;
+            continue;
+        }
+
+        if (!line.empty()) {
+            if (!parseHeaderLine(line, line_off)) return Status::Error;
+            continue;
+        }
+
+        body_start = scan;
+        state = State::Body;
+    }
+
+    // widoki budowane za kazdym razem wzgledem biezacego bufora
+    size_t need = content_length > 0 ? static_cast<size_t>(content_length) : 0;
+    bool complete = buffer.size() - body_start >= need;
+    consumed_bytes = body_start + (complete ? need : 0);
+    buildRequest(buffer);
+    if (!complete)
+        return Status::NeedMore;
+
+    state = State::Done;
+    return Status::Complete;
+}
+
+bool HttpParser::parseRequestLine(std::string_view line, size_t line_off) {
+    size_t sp1 = line.find(' ');
+    if (sp1 == std::string_view::npos || sp1 == 0) return false;
+    size_t sp2 = line.find(' ', sp1 + 1);
+    if (sp2 == std::string_view::npos || sp2 == sp1 + 1) return false;
+
+    for (size_t i = 0; i < sp1; ++i)
+        if (!isTchar(line[i])) return false;
+
+    std::string_view version = line.substr(sp2 + 1);
+    if (version.size() != 8 || version.substr(0, 7) != "HTTP/1." ||
+        !std::isdigit(static_cast<unsigned char>(version[7])))
+        return false;
+
+    method = {static_cast<uint32_t>(line_off), static_cast<uint32_t>(sp1)};
+    target = {static_cast<uint32_t>(line_off + sp1 + 1), static_cast<uint32_t>(sp2 - sp1 - 1)};
+    version_minor = version[7] - '0';
+    return true;
+}
+
+bool HttpParser::parseHeaderLine(std::string_view line, size_t line_off) {
+    // obs-fold (kontynuacja od spacji) jest przestarzaly - odrzucamy
+    size_t colon = line.find(':');
+    if (colon == std::string_view::npos || colon == 0 || line[0] == ' ' || line[0] == '\t') {
+        fail(400);
+        return false;
+    }
+    for (size_t i = 0; i < colon; ++i) {
+        if (!isTchar(line[i])) {
+            fail(400);
+            return false;
+        }
+    }
+    if (header_count == HttpRequest::MAX_HEADERS) {
+        fail(431);
+        return false;
+    }
+
+    std::string_view name = line.substr(0, colon);
+    std::string_view raw = line.substr(colon + 1);
+    std::string_view value = trimOws(raw);
+    size_t value_off = line_off + colon + 1 + static_cast<size_t>(value.data() - raw.data());
+    if (value.empty()) value_off = line_off + line.size();
+
+    if (iequals(name, "Content-Length")) {
+        if (value.empty()) {
+            fail(400);
+            return false;
+        }
+        long parsed = 0;
+        for (char c : value) {
+            if (!std::isdigit(static_cast<unsigned char>(c))) {
+                fail(400);
+                return false;
+            }
+            if (parsed > (std::numeric_limits<long>::max() - 9) / 10) {
+                fail(413);
+                return false;
+            }
+            parsed = parsed * 10 + (c - '0');
+        }
+        if (content_length >= 0 && content_length != parsed) {
+            fail(400); // sprzeczne Content-Length - ochrona przed request smuggling
+            return false;
+        }
+        if (static_cast<unsigned long>(parsed) > max_body_bytes) {
+            fail(413);
+            return false;
+        }
+        content_length = parsed;
+    } else if (iequals(name, "Transfer-Encoding")) {
+        fail(501); // ciala chunked w zapytaniach nie obslugujemy
+        return false;
+    }
+
+    names[header_count] = {static_cast<uint32_t>(line_off), static_cast<uint32_t>(colon)};
+    values[header_count] = {static_cast<uint32_t>(value_off), static_cast<uint32_t>(value.size())};
+    ++header_count;
+    return true;
+}
+
+void HttpParser::buildRequest(std::string_view buffer) {
+    auto view = [&](Span s) { return buffer.substr(s.off, s.len); };
+
+    req.method = view(method);
+    req.target = view(target);
+    size_t q = req.target.find('?');
+    req.path = req.target.substr(0, q);
+    req.query = q != std::string_view::npos ? req.target.substr(q + 1) : std::string_view();
+
+    req.header_count = header_count;
+    for (size_t i = 0; i < header_count; ++i)
+        req.headers[i] = {view(names[i]), view(values[i])};
+
+    req.version_minor = version_minor;
+    req.content_length = content_length;
+    req.body = buffer.substr(body_start, consumed_bytes - body_start);
+
+    // HTTP/1.1 domyslnie keep-alive, HTTP/1.0 tylko na wyrazne zyczenie
+    std::string_view connection = req.header("Connection");
+    if (hasToken(connection, "close"))
+        req.keep_alive = false;
+    else
+        req.keep_alive = version_minor >= 1 || hasToken(connection, "keep-alive");
+}
+
+std::string_view multipartBoundary(std::string_view content_type) {
+    static constexpr std::string_view key = "boundary=";
+    for (size_t i = 0; i + key.size() <= content_type.size(); ++i) {
+        if (!iequals(content_type.substr(i, key.size()), key)) continue;
+        std::string_view b = content_type.substr(i + key.size());
+        b = trimOws(b.substr(0, b.find(';')));
+        if (b.size() >= 2 && b.front() == '"' && b.back() == '"') {
+            b.remove_prefix(1);
+            b.remove_suffix(1);
+        }
+        return b;
+    }
+    return {};
+}
+
+void QueryParams::parse(std::string_view source) {
+    while (!source.empty() && count < MAX_PARAMS) {
+        size_t amp = source.find('&');
+        std::string_view pair = source.substr(0, amp);
+        if (!pair.empty()) {
+            size_t eq = pair.find('=');
+            params[count].name = pair.substr(0, eq);
+            params[count].value = eq == std::string_view::npos ? std::string_view() : pair.substr(eq + 1);
+            ++count;
+        }
+        if (amp == std::string_view::npos) break;
+        source.remove_prefix(amp + 1);
+    }
+}
+
+std::string_view QueryParams::get(std::string_view key) const {
+    for (size_t i = 0; i < count; ++i)
+        if (params[i].name == key) return params[i].value;
+    return {};
+}
+
+bool QueryParams::has(std::string_view key) const {
+    for (size_t i = 0; i < count; ++i)
+        if (params[i].name == key) return true;
+    return false;
+}
+
+long QueryParams::getInt(std::string_view key, long fallback) const {
+    std::string_view v = get(key);
+    long out = 0;
+    auto res = std::from_chars(v.data(), v.data() + v.size(), out);
+    if (v.empty() || res.ec != std::errc() || res.ptr != v.data() + v.size() || out < 0)
+        return fallback;
+    return out;
+}
+
+double QueryParams::getDouble(std::string_view key, double fallback) const {
+    std::string_view v = get(key);
+    double out = 0;
+    auto res = std::from_chars(v.data(), v.data() + v.size(), out);
+    if (v.empty() || res.ec != std::errc() || res.ptr != v.data() + v.size() || !(out >= 0))
+        return fallback;
+    return out;
+}
+
+static bool parseOffset(std::string_view s, uint64_t& out) {
+    if (s.empty()) return false;
+    auto res = std::from_chars(s.data(), s.data() + s.size(), out);
+    return res.ec == std::errc() && res.ptr == s.data() + s.size();
+}
+
+RangeResult parseByteRange(std::string_view range, uint64_t size, uint64_t& first, uint64_t& last) {
+    range = trimOws(range);
+    if (range.size() < 6 || !iequals(range.substr(0, 6), "bytes="))
+        return RangeResult::None;
+    range = trimOws(range.substr(6));
+    if (range.find(',') != std::string_view::npos)
+        return RangeResult::None; // wiele zakresow (multipart/byteranges) - cala odpowiedz
+
+    size_t dash = range.find('-');
+    if (dash == std::string_view::npos)
+        return RangeResult::None;
+    std::string_view a = trimOws(range.substr(0, dash));
+    std::string_view b = trimOws(range.substr(dash + 1));
+
+    if (a.empty()) {
+        // bytes=-n: ostatnie n bajtow
+        uint64_t n = 0;
+        if (!parseOffset(b, n)) return RangeResult::None;
+        if (n == 0 || size == 0) return RangeResult::Unsatisfiable;
+        first = n >= size ? 0 : size - n;
+        last = size - 1;
+        return RangeResult::Satisfiable;
+    }
+
+    if (!parseOffset(a, first)) return RangeResult::None;
+    if (b.empty()) {
+        last = size - 1;
+    } else {
+        if (!parseOffset(b, last) || last < first) return RangeResult::None;
+        last = std::min(last, size - 1);
+    }
+    if (first >= size) return RangeResult::Unsatisfiable;
+    return RangeResult::Satisfiable;
+}
+
+// Wpis wprost dla kodowania ma pierwszenstwo przed "*" (RFC 9110 12.5.3):
+// "*, gzip;q=0" to odmowa gzip. "*" liczy sie tylko, gdy kodowania nie wymieniono.
+bool acceptsEncoding(std::string_view accept_encoding, std::string_view coding) {
+    int named = -1; // -1 = brak wpisu, 0 = odmowa (q=0), 1 = dopuszczone
+    int star = -1;
+    while (!accept_encoding.empty()) {
+        size_t comma = accept_encoding.find(',');
+        std::string_view item = accept_encoding.substr(0, comma);
+        size_t semi = item.find(';');
+        std::string_view name = trimOws(item.substr(0, semi));
+        bool is_named = iequals(name, coding);
+        if (is_named || name == "*") {
+            bool accepted = true;
+            if (semi != std::string_view::npos) {
+                std::string_view param = trimOws(item.substr(semi + 1));
+                // q=0, q=0.0, q=0.000 - wszystko inne jest dodatnie
+                if (param.size() >= 2 && lower(param[0]) == 'q' && param[1] == '=')
+                    accepted = param.substr(2).find_first_not_of("0.") != std::string_view::npos;
+            }
+            int& slot = is_named ? named : star;
+            if (slot < 0) slot = accepted ? 1 : 0;
+        }
+        if (comma == std::string_view::npos) break;
+        accept_encoding.remove_prefix(comma + 1);
+    }
+    return named >= 0 ? named == 1 : star == 1;
+}
+
+bool etagMatches(std::string_view if_none_match, std::string_view etag) {
+    auto opaque = [](std::string_view tag) {
+        if (tag.size() >= 2 && tag[0] == 'W' && tag[1] == '/') tag.remove_prefix(2);
+        return tag;
+    };
+    if (trimOws(if_none_match) == "*") return true;
+    etag = opaque(etag);
+    while (!if_none_match.empty()) {
+        size_t comma = if_none_match.find(',');
+        if (opaque(trimOws(if_none_match.substr(0, comma))) == etag) return true;
+        if (comma == std::string_view::npos) break;
+        if_none_match.remove_prefix(comma + 1);
+    }
+    return false;
+}
@@ -0,0 +1,191 @@
+#include "http_response.h"
+#include <charconv>
+#include <cstdio>
+
+namespace {
+
+struct StatusEntry {
+    int code;
+    const char* text;
+};
+
+constexpr StatusEntry STATUS_TABLE[] = {
+    {200, "OK"},
+    {201, "Created"},
+    {204, "No Content"},
+    {206, "Partial Content"},
+    {301, "Moved Permanently"},
+    {302, "Found"},
+    {304, "Not Modified"},
+    {400, "Bad Request"},
+    {403, "Forbidden"},
+    {404, "Not Found"},
+    {405, "Method Not Allowed"},
+    {408, "Request Timeout"},
+    {411, "Length Required"},
+    {413, "Content Too Large"},
+    {414, "URI Too Long"},
+    {416, "Range Not Satisfiable"},
+    {431, "Request Header Fields Too Large"},
+    {500, "Internal Server Error"},
+    {501, "Not Implemented"},
+    {503, "Service Unavailable"},
+};
+
+// bufory powyzej tego rozmiaru nie sa trzymane miedzy zapytaniami
+constexpr size_t MAX_RETAINED_BYTES = 64 * 1024;
+
+void appendUnsigned(std::string& out, uint64_t v) {
+    char buf[24];
+    auto res = std::to_chars(buf, buf + sizeof(buf), v);
+    out.append(buf, static_cast<size_t>(res.ptr - buf));
+}
+
+void appendSigned(std::string& out, int64_t v) {
+    char buf[24];
+    auto res = std::to_chars(buf, buf + sizeof(buf), v);
+    out.append(buf, static_cast<size_t>(res.ptr - buf));
+}
+
+} // namespace
+
+const char* httpStatusText(int status) {
+    for (const auto& entry : STATUS_TABLE)
+        if (entry.code == status) return entry.text;
+    switch (status / 100) {
+        case 1: return "Informational";
+        case 2: return "Success";
+        case 3: return "Redirection";
+        case 4: return "Client Error";
+        default: return "Server Error";
+    }
+}
+
+void JsonWriter::separator() {
+    if (need_comma) out += ',';
+}
+
+JsonWriter& JsonWriter::beginObject() {
+    separator();
+    out += '{';
+    need_comma = false;
+    return *this;
+}
+
+JsonWriter& JsonWriter::endObject() {
+    out += '}';
+    need_comma = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::beginArray() {
+    separator();
+    out += '[';
+    need_comma = false;
+    return *this;
+}
+
+JsonWriter& JsonWriter::endArray() {
+    out += ']';
+    need_comma = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::key(std::string_view name) {
+    value(name);
+    out += ':';
+    need_comma = false;
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(std::string_view s) {
+    separator();
+    out += '"';
+    for (char c : s) {
+        switch (c) {
+            case '\\': out += "\\\\"; break;
+            case '"':  out += "\\\""; break;
+            case '\n': out += "\\n";  break;
+            case '\r': out += "\\r";  break;
+            case '\t': out += "\\t";  break;
+            default:
+                // pozostale znaki sterujace pomijamy
+                if (static_cast<unsigned char>(c) >= 0x20)
+                    out += c;
+        }
+    }
+    out += '"';
+    need_comma = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(int64_t v) {
+    separator();
+    appendSigned(out, v);
+    need_comma = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(uint64_t v) {
+    separator();
+    appendUnsigned(out, v);
+    need_comma = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(double v) {
+    separator();
+    // ten sam format co std::to_string (6 miejsc po przecinku)
+    char buf[64];
+    int n = std::snprintf(buf, sizeof(buf), "%f", v);
+    out.append(buf, static_cast<size_t>(n));
+    need_comma = true;
+    return *this;
+}
+
+void HttpResponse::start(int status) {
+    head_buf.clear();
+    head_buf += "HTTP/1.1 ";
+    appendUnsigned(head_buf, static_cast<uint64_t>(status));
+    head_buf += ' ';
+    head_buf += httpStatusText(status);
+    head_buf += "\r\n";
+}
+
+void HttpResponse::header(std::string_view name, std::string_view value) {
+    head_buf += name;
+    head_buf += ": ";
+    head_buf += value;
+    head_buf += "\r\n";
+}
+
+void HttpResponse::header(std::string_view name, uint64_t value) {
+    head_buf += name;
+    head_buf += ": ";
+    appendUnsigned(head_buf, value);
+    head_buf += "\r\n";
+}
+
+void HttpResponse::endHeaders(bool keep_alive, int keepalive_timeout_s, int keepalive_remaining) {
+    if (keep_alive) {
+        head_buf += "Connection: keep-alive\r\nKeep-Alive: timeout=";
+        appendSigned(head_buf, keepalive_timeout_s);
+        head_buf += ", max=";
+        appendSigned(head_buf, keepalive_remaining);
+        head_buf += "\r\n\r\n";
+    } else {
+        head_buf += "Connection: close\r\n\r\n";
+    }
+}
+
+std::string& HttpResponse::beginBody() {
+    body_buf.clear();
+    return body_buf;
+}
+
+void HttpResponse::trim() {
+    if (body_buf.capacity() > MAX_RETAINED_BYTES)
+        std::string().swap(body_buf);
+    if (head_buf.capacity() > MAX_RETAINED_BYTES)
+        std::string().swap(head_buf);
+}
@@ -0,0 +1,116 @@
+#include "library.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <dirent.h>
+#include <stdexcept>
+
+static bool sameFile(const struct stat& st, off_t size, ino_t inode, const timespec& mtime) {
+    return st.st_size == size && st.st_ino == inode &&
+           st.st_mtim.tv_sec == mtime.tv_sec && st.st_mtim.tv_nsec == mtime.tv_nsec;
+}
+
+TrackCache::TrackCache(size_t max_bytes) : max_bytes(max_bytes) {}
+
+std::shared_ptr<const WavFile> TrackCache::get(const std::string& path) {
+    struct stat st{};
+    if (stat(path.c_str(), &st) != 0)
+        throw std::runtime_error("Cannot open WAV file: " + path);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(path);
+        if (it != entries.end() && sameFile(st, it->second.size, it->second.inode, it->second.mtime)) {
+            it->second.last_used = ++use_clock;
+            ++hits;
+            return it->second.wav;
+        }
+    }
+
+    // mapowanie bez blokady - inne stacje nie czekaja na plik
+    auto wav = std::make_shared<const WavFile>(loadWavFile(path));
+
+    std::lock_guard<std::mutex> lock(mutex);
+    ++misses;
+    Entry& entry = entries[path];
+    if (entry.wav) bytes -= entry.wav->data.size();
+    entry.wav = wav;
+    entry.size = st.st_size;
+    entry.inode = st.st_ino;
+    entry.mtime = st.st_mtim;
+    entry.last_used = ++use_clock;
+    bytes += wav->data.size();
+    evict();
+    return wav;
+}
+
+// najdawniej uzyte wpisy az do limitu; ostatnio dodany zostaje, nawet gdy sam go przekracza
+void TrackCache::evict() {
+    while (bytes > max_bytes && entries.size() > 1) {
+        auto oldest = entries.begin();
+        for (auto it = entries.begin(); it != entries.end(); ++it)
+            if (it->second.last_used < oldest->second.last_used) oldest = it;
+        bytes -= oldest->second.wav->data.size();
+        entries.erase(oldest);
+    }
+}
+
+TrackCache::Stats TrackCache::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    Stats s;
+    s.entries = entries.size();
+    s.bytes = bytes;
+    s.hits = hits;
+    s.misses = misses;
+    return s;
+}
+
+LibraryIndex::LibraryIndex(std::chrono::milliseconds revalidate) : revalidate(revalidate) {}
+
+static std::vector<std::string> scanWavFiles(const std::string& dir) {
+    std::vector<std::string> files;
+    DIR* dp = opendir(dir.c_str());
+    if (!dp) return files;
+    struct dirent* ent;
+    while ((ent = readdir(dp)) != nullptr) {
+        const char* name = ent->d_name;
+        if (std::strcmp(name, ".") == 0 || std::strcmp(name, "..") == 0) continue;
+        std::string fname = name;
+        auto pos = fname.find_last_of('.');
+        if (pos == std::string::npos) continue;
+        std::string ext = fname.substr(pos + 1);
+        std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c){ return std::tolower(c); });
+        if (ext == "wav")
+            files.push_back(dir + "/" + fname);
+    }
+    closedir(dp);
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+std::vector<std::string> LibraryIndex::list(const std::string& dir) {
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry& entry = entries[dir];
+    if (entry.valid && now - entry.checked < revalidate)
+        return entry.files;
+
+    entry.checked = now;
+    struct stat st{};
+    if (stat(dir.c_str(), &st) != 0) {
+        entry.files.clear();
+        entry.valid = true;
+        return entry.files;
+    }
+    if (!entry.valid || st.st_mtim.tv_sec != entry.mtime.tv_sec || st.st_mtim.tv_nsec != entry.mtime.tv_nsec) {
+        entry.files = scanWavFiles(dir);
+        entry.mtime = st.st_mtim;
+        entry.valid = true;
+    }
+    return entry.files;
+}
+
+void LibraryIndex::invalidate(const std::string& dir) {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.erase(dir);
+}
@@ -0,0 +1,84 @@
+#include "mixer.h"
+#include <algorithm>
+#include <cstring>
+
+// ile ramek utworu przelicza sie naraz - ogranicza bufor przeliczonych probek
+static constexpr size_t DECK_CHUNK_FRAMES = 1024;
+
+Deck::Deck(size_t block_bytes, size_t blocks) : source(block_bytes, blocks) {}
+
+void Deck::open(std::shared_ptr<const WavFile> wav, const PcmFormat& out, size_t hold_frames) {
+    const PcmFormat in = wav ? PcmFormat{wav->sampleRate, wav->channels, wav->bitsPerSample} : PcmFormat{};
+    in_frame = in.frameSize();
+    out_channels = static_cast<size_t>(out.channels);
+    converted.clear();
+    converted_offset = 0;
+    pos = 0;
+    written = 0;
+    end = in_frame && in.sample_rate > 0 ? wav->data.size() : 0;
+
+    size_t hold_bytes = 0;
+    if (end) {
+        converter.reset(in, out);
+        converter.reserve(DECK_CHUNK_FRAMES);
+        converted.reserve(converter.maxOutputFrames(DECK_CHUNK_FRAMES) * out_channels);
+        if (hold_frames)
+            hold_bytes = static_cast<size_t>((uint64_t(hold_frames) * in.sample_rate / out.sample_rate + 2
+                                              + DECK_CHUNK_FRAMES) * in_frame);
+    }
+    source.open(std::move(wav), hold_bytes);
+}
+
+size_t Deck::render(float* dst, size_t frames, BroadcastRing* native) {
+    size_t done = 0;
+    while (done < frames) {
+        if (converted_offset == converted.size()) {
+            converted.clear();
+            converted_offset = 0;
+            if (pos >= end) break;
+            size_t len = std::min(end - pos, DECK_CHUNK_FRAMES * in_frame);
+            const uint8_t* p = source.peek(pos, len);
+            len -= len % in_frame;
+            if (len == 0) break; // watek stacji nie zdazyl
+            converter.convert(p, len / in_frame, converted);
+            pos += len;
+            if (native) {
+                // zagrane probki trafiaja raz do wspolnego bufora sluchaczy
+                native->write(p, len);
+                written = pos;
+                source.consume(pos);
+            }
+            continue;
+        }
+        const size_t n = std::min(frames - done, (converted.size() - converted_offset) / out_channels);
+        std::memcpy(dst + done * out_channels, converted.data() + converted_offset, n * out_channels * sizeof(float));
+        converted_offset += n * out_channels;
+        done += n;
+    }
+    return done;
+}
+
+void Deck::flushHeld(BroadcastRing& ring) {
+    while (written < pos) {
+        size_t len = pos - written;
+        const uint8_t* p = source.peek(written, len);
+        if (len == 0) break;
+        ring.write(p, len);
+        written += len;
+    }
+    source.consume(written);
+}
+
+void Deck::stop() {
+    end = std::min(end, pos);
+    converted.clear();
+    converted_offset = 0;
+}
+
+uint64_t Deck::remainingFrames() const {
+    const uint64_t pending = out_channels ? (converted.size() - converted_offset) / out_channels : 0;
+    if (!in_frame || pos >= end) return pending;
+    const PcmFormat& in = converter.input();
+    const PcmFormat& out = converter.output();
+    return pending + (end - pos) / in_frame * static_cast<uint64_t>(out.sample_rate) / static_cast<uint64_t>(in.sample_rate);
+}
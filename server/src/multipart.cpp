@@ -0,0 +1,201 @@
+#include "multipart.h"
+#include <algorithm>
+#include <cstdio>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MultipartFileStream::MultipartFileStream(std::string_view boundary, std::function<std::string(const std::string&)> pathFor)
+    : delimiter("\r\n--" + std::string(boundary)), path_for(std::move(pathFor)) {
+    // pierwszy delimiter nie ma poprzedzajacego \r\n - dokladamy go sztucznie
+    carry = "\r\n";
+}
+
+MultipartFileStream::~MultipartFileStream() {
+    if (out.is_open())
+        out.close();
+    if (!tmp_path.empty())
+        unlink(tmp_path.c_str());
+}
+
+bool MultipartFileStream::fail(const std::string& why) {
+    if (state != State::Failed)
+        error_text = why;
+    state = State::Failed;
+    return false;
+}
+
+bool MultipartFileStream::feed(const char* data, size_t len) {
+    while (len > 0) {
+        size_t used = 0;
+        switch (state) {
+            case State::Skip:
+            case State::Data:
+                used = scanBody(data, len);
+                break;
+            case State::AfterDelimiter:
+                used = scanAfterDelimiter(data, len);
+                break;
+            case State::PartHeaders:
+                used = scanPartHeaders(data, len);
+                break;
+            case State::Epilogue:
+                return true; // wszystko po --boundary-- ignorujemy
+            case State::Failed:
+                return false;
+        }
+        data += used;
+        len -= used;
+    }
+    return state != State::Failed;
+}
+
+void MultipartFileStream::emit(const char* data, size_t len) {
+    if (state != State::Data || len == 0) return;
+    out.write(data, static_cast<std::streamsize>(len));
+    if (!out) {
+        fail("write failed: " + tmp_path);
+        return;
+    }
+    written += len;
+}
+
+// Szuka delimitera; wszystko przed nim to tresc czesci. Koncowka krotsza niz
+// delimiter zostaje w carry do nastepnej porcji.
+size_t MultipartFileStream::scanBody(const char* data, size_t len) {
+    const size_t keep = delimiter.size() - 1;
+
+    auto found = [&](const char* body, size_t body_len) {
+        emit(body, body_len);
+        if (state == State::Data) {
+            out.close();
+            file_done = true;
+        }
+        if (state != State::Failed) {
+            state = State::AfterDelimiter;
+            headers.clear();
+        }
+    };
+
+    if (!carry.empty()) {
+        // delimiter moze zaczynac sie w carry i konczyc w nowej porcji
+        std::string window = carry;
+        window.append(data, std::min(len, keep));
+        size_t idx = window.find(delimiter);
+        if (idx != std::string::npos) {
+            size_t used = idx + delimiter.size() - carry.size();
+            carry.clear();
+            found(window.data(), idx);
+            return used;
+        }
+        if (len < keep) {
+            size_t flush = window.size() > keep ? window.size() - keep : 0;
+            emit(window.data(), flush);
+            carry = window.substr(flush);
+            return len;
+        }
+        emit(carry.data(), carry.size());
+        carry.clear();
+    }
+
+    std::string_view view(data, len);
+    size_t idx = view.find(delimiter);
+    if (idx != std::string_view::npos) {
+        found(data, idx);
+        return idx + delimiter.size();
+    }
+
+    size_t flush = len > keep ? len - keep : 0;
+    emit(data, flush);
+    carry.assign(data + flush, len - flush);
+    return len;
+}
+
+// Po delimiterze: "--" konczy tresc, "\r\n" otwiera kolejna czesc.
+size_t MultipartFileStream::scanAfterDelimiter(const char* data, size_t len) {
+    size_t need = 2 - headers.size();
+    size_t take = std::min(need, len);
+    headers.append(data, take);
+    if (headers.size() < 2) return take;
+
+    if (headers == "--") {
+        state = State::Epilogue;
+    } else if (headers == "\r\n") {
+        state = State::PartHeaders;
+        headers.clear();
+    } else {
+        fail("malformed multipart delimiter");
+    }
+    return take;
+}
+
+size_t MultipartFileStream::scanPartHeaders(const char* data, size_t len) {
+    size_t old_size = headers.size();
+    size_t take = std::min(len, MAX_PART_HEADERS + 4 - old_size);
+    headers.append(data, take);
+
+    size_t idx = headers.find("\r\n\r\n", old_size >= 3 ? old_size - 3 : 0);
+    if (idx == std::string::npos) {
+        if (headers.size() > MAX_PART_HEADERS) {
+            fail("multipart part headers too large");
+            return len;
+        }
+        return take;
+    }
+
+    size_t used = idx + 4 - old_size;
+    headers.resize(idx);
+    openPart();
+    return used;
+}
+
+bool MultipartFileStream::openPart() {
+    // zapisujemy tylko pierwsza czesc z plikiem, reszte pomijamy
+    state = State::Skip;
+    if (file_done || out.is_open()) return true;
+
+    auto dispoPos = headers.find("Content-Disposition:");
+    if (dispoPos == std::string::npos) return true;
+    auto fnamePos = headers.find("filename=", dispoPos);
+    if (fnamePos == std::string::npos) return true;
+    fnamePos += 9;
+
+    std::string filename;
+    if (fnamePos < headers.size() && headers[fnamePos] == '"') {
+        ++fnamePos;
+        auto endq = headers.find('"', fnamePos);
+        if (endq == std::string::npos) return fail("malformed filename");
+        filename = headers.substr(fnamePos, endq - fnamePos);
+    } else {
+        auto endsp = headers.find_first_of(";\r\n", fnamePos);
+        filename = headers.substr(fnamePos, endsp - fnamePos);
+    }
+
+    out_path = path_for(filename);
+    if (out_path.empty()) return fail("cannot store " + filename);
+
+    // plik .part nie pojawia sie w /library, dopoki upload sie nie zakonczy; nazwa
+    // unikalna (mkstemps), wiec dwa uploady tego samego pliku nie pisza do jednego
+    std::string tmpl = out_path + ".XXXXXX.part";
+    int fd = mkstemps(&tmpl[0], 5);
+    if (fd < 0)
+        return fail("cannot create temporary file for " + out_path);
+    fchmod(fd, 0644);
+    close(fd);
+    tmp_path = tmpl;
+    out.open(tmp_path, std::ios::binary | std::ios::trunc);
+    if (!out)
+        return fail("cannot open " + tmp_path + " for writing");
+    state = State::Data;
+    return true;
+}
+
+bool MultipartFileStream::finish() {
+    if (state == State::Failed) return false;
+    if (!file_done) return fail("no complete file part in upload");
+    if (state != State::Epilogue) return fail("missing closing multipart boundary");
+
+    if (std::rename(tmp_path.c_str(), out_path.c_str()) != 0)
+        return fail("cannot rename " + tmp_path);
+    tmp_path.clear();
+    return true;
+}
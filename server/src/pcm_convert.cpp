@@ -0,0 +1,100 @@
+#include "pcm_convert.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+void writeSample(uint8_t* p, float v, int bits) {
+    if (bits == 24) {
+        long s = std::clamp(std::lround(v * 8388608.0f), -8388608L, 8388607L);
+        p[0] = s & 0xFF;
+        p[1] = (s >> 8) & 0xFF;
+        p[2] = (s >> 16) & 0xFF;
+        return;
+    }
+    long s = std::clamp(std::lround(v * 32768.0f), -32768L, 32767L);
+    p[0] = s & 0xFF;
+    p[1] = (s >> 8) & 0xFF;
+}
+
+} // namespace
+
+void floatToPcm(const float* src, size_t samples, int bits, uint8_t* dst) {
+    const size_t bytes = static_cast<size_t>(bits / 8);
+    for (size_t i = 0; i < samples; ++i, dst += bytes)
+        writeSample(dst, src[i], bits);
+}
+
+void PcmConverter::reset(const PcmFormat& in, const PcmFormat& out) {
+    in_fmt = in;
+    out_fmt = out;
+    step = static_cast<double>(in.sample_rate) / out.sample_rate;
+    pos = 0.0;
+    const size_t channels = static_cast<size_t>(out.channels);
+    prev.assign(channels, 0.0f);
+    frame_a.assign(channels, 0.0f);
+    frame_b.assign(channels, 0.0f);
+}
+
+// Jedna ramka wejscia jako probki w kanalach wyjscia: mono rozchodzi sie na
+// wszystkie kanaly, wiele kanalow do mono to srednia, pozostale kanaly wyjscia
+// powtarzaja ostatni kanal wejscia.
+void PcmConverter::readFrame(const float* p, float* dst) const {
+    if (out_fmt.channels == 1 && in_fmt.channels > 1) {
+        float sum = 0.0f;
+        for (int ch = 0; ch < in_fmt.channels; ++ch)
+            sum += p[ch];
+        dst[0] = sum / in_fmt.channels;
+        return;
+    }
+    for (int ch = 0; ch < out_fmt.channels; ++ch)
+        dst[ch] = p[std::min(ch, in_fmt.channels - 1)];
+}
+
+void PcmConverter::convert(const uint8_t* data, size_t frames, std::vector<float>& dst) {
+    if (frames == 0) return;
+    const size_t channels = static_cast<size_t>(out_fmt.channels);
+    if (in_fmt.sample_rate == out_fmt.sample_rate && in_fmt.channels == out_fmt.channels) {
+        const size_t at = dst.size();
+        dst.resize(at + frames * channels);
+        pcmToFloat(data, frames * channels, in_fmt.bits, dst.data() + at);
+        return;
+    }
+
+    // caly blok na float naraz, dalej juz tylko kanaly i interpolacja
+    const size_t in_channels = static_cast<size_t>(in_fmt.channels);
+    block.resize(frames * in_channels);
+    pcmToFloat(data, frames * in_channels, in_fmt.bits, block.data());
+    auto frameAt = [&](long i, float* out) {
+        if (i < 0) std::copy(prev.begin(), prev.end(), out);
+        else readFrame(block.data() + static_cast<size_t>(i) * in_channels, out);
+    };
+
+    // ramka wyjscia na pozycji pos potrzebuje ramek floor(pos) i floor(pos) + 1,
+    // ostatnia ramka bloku czeka wiec na nastepny blok (jako prev)
+    const double last = static_cast<double>(frames - 1);
+    dst.reserve(dst.size() + maxOutputFrames(frames) * channels);
+    long loaded = -2; // ktora ramka jest w frame_a (frame_b to nastepna)
+    while (pos < last) {
+        long i0 = static_cast<long>(std::floor(pos));
+        if (i0 != loaded) {
+            if (i0 == loaded + 1) std::swap(frame_a, frame_b);
+            else frameAt(i0, frame_a.data());
+            frameAt(i0 + 1, frame_b.data());
+            loaded = i0;
+        }
+        float frac = static_cast<float>(pos - i0);
+        for (size_t ch = 0; ch < channels; ++ch)
+            dst.push_back(frame_a[ch] + (frame_b[ch] - frame_a[ch]) * frac);
+        pos += step;
+    }
+
+    readFrame(block.data() + (frames - 1) * in_channels, prev.data());
+    pos -= static_cast<double>(frames);
+}
+
+uint64_t PcmConverter::outputBytes(const PcmFormat& in, const PcmFormat& out, uint64_t in_bytes) {
+    if (in.frameSize() == 0 || in.sample_rate <= 0) return 0;
+    uint64_t frames = in_bytes / in.frameSize();
+    return frames * static_cast<uint64_t>(out.sample_rate) / static_cast<uint64_t>(in.sample_rate) * out.frameSize();
+}
@@ -0,0 +1,259 @@
+#include "pcm_convert.h"
+#include <cstring>
+
+#ifndef PCM_SIMD
+#define PCM_SIMD 1
+#endif
+
+#if PCM_SIMD && (defined(__x86_64__) || defined(__i386__))
+#define PCM_SIMD_X86 1
+#include <immintrin.h>
+#else
+#define PCM_SIMD_X86 0
+#endif
+
+namespace {
+
+constexpr float SCALE_16 = 1.0f / 32768.0f;
+constexpr float SCALE_24 = 1.0f / 8388608.0f;
+
+void scalar16(const uint8_t* src, size_t samples, float* dst) {
+    for (size_t i = 0; i < samples; ++i, src += 2)
+        dst[i] = static_cast<int16_t>(src[0] | (src[1] << 8)) * SCALE_16;
+}
+
+void scalar24(const uint8_t* src, size_t samples, float* dst) {
+    for (size_t i = 0; i < samples; ++i, src += 3) {
+        // bajt najstarszy na gorze slowa, przesuniecie arytmetyczne rozszerza znak
+        int32_t sample = static_cast<int32_t>((uint32_t(src[0]) << 8) | (uint32_t(src[1]) << 16) | (uint32_t(src[2]) << 24)) >> 8;
+        dst[i] = sample * SCALE_24;
+    }
+}
+
+// Przejscie: dst = a * ga + b * gb, wzmocnienia liczone raz na ramke (wszystkie
+// kanaly ramki dostaja te same). Wektory licza dokladnie to samo (te same
+// dzialania w tej samej kolejnosci), wiec wynik nie zalezy od wersji petli.
+struct MixGains {
+    float a_from, a_step;
+    float b_from, b_step;
+};
+
+void mixTail(const float* a, const float* b, float* dst, size_t first, size_t frames, size_t channels, const MixGains& g) {
+    for (size_t f = first; f < frames; ++f) {
+        const float t = static_cast<float>(f);
+        const float ga = g.a_from + g.a_step * t;
+        const float gb = g.b_from + g.b_step * t;
+        for (size_t c = 0, i = f * channels; c < channels; ++c, ++i)
+            dst[i] = a[i] * ga + b[i] * gb;
+    }
+}
+
+void scalarMix(const float* a, const float* b, float* dst, size_t frames, size_t channels, const MixGains& g) {
+    mixTail(a, b, dst, 0, frames, channels, g);
+}
+
+#if PCM_SIMD_X86
+
+__attribute__((target("sse2")))
+void sse2_16(const uint8_t* src, size_t samples, float* dst) {
+    const __m128 scale = _mm_set1_ps(SCALE_16);
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 8 <= samples; i += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2));
+        // int16 w gornej polowie int32, potem przesuniecie arytmetyczne = rozszerzenie znaku
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(zero, v), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(zero, v), 16);
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+        _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+    scalar16(src + i * 2, samples - i, dst + i);
+}
+
+__attribute__((target("sse2")))
+void sse2_24(const uint8_t* src, size_t samples, float* dst) {
+    const __m128 scale = _mm_set1_ps(SCALE_24);
+    size_t i = 0;
+    // 4 probki = 12 bajtow, ale ostatnie slowo czyta bajt dalej - stad i + 5
+    for (; i + 5 <= samples; i += 4) {
+        const uint8_t* p = src + i * 3;
+        int32_t w[4];
+        std::memcpy(&w[0], p, 4);
+        std::memcpy(&w[1], p + 3, 4);
+        std::memcpy(&w[2], p + 6, 4);
+        std::memcpy(&w[3], p + 9, 4);
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(w));
+        v = _mm_srai_epi32(_mm_slli_epi32(v, 8), 8);
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(v), scale));
+    }
+    scalar24(src + i * 3, samples - i, dst + i);
+}
+
+__attribute__((target("avx2")))
+void avx2_16(const uint8_t* src, size_t samples, float* dst) {
+    const __m256 scale = _mm256_set1_ps(SCALE_16);
+    size_t i = 0;
+    for (; i + 16 <= samples; i += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2 + 16));
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(a)), scale));
+        _mm256_storeu_ps(dst + i + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(b)), scale));
+    }
+    scalar16(src + i * 2, samples - i, dst + i);
+}
+
+__attribute__((target("avx2")))
+void avx2_24(const uint8_t* src, size_t samples, float* dst) {
+    const __m256 scale = _mm256_set1_ps(SCALE_24);
+    // slowa 0-2 (bajty 0-11) do dolnej polowy, 3-5 (bajty 12-23) do gornej
+    const __m256i spread = _mm256_setr_epi32(0, 1, 2, 3, 3, 4, 5, 6);
+    // w kazdej polowie probka k (bajty 3k..3k+2) na gorne 3 bajty slowa k
+    const __m256i place = _mm256_setr_epi8(
+        -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11,
+        -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+    size_t i = 0;
+    // 8 probek = 24 bajty, ale ladowanie bierze 32 - stad i + 11
+    for (; i + 11 <= samples; i += 8) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * 3));
+        v = _mm256_shuffle_epi8(_mm256_permutevar8x32_epi32(v, spread), place);
+        v = _mm256_srai_epi32(v, 8);
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(v), scale));
+    }
+    scalar24(src + i * 3, samples - i, dst + i);
+}
+
+// Wektor to cale ramki, gdy liczba kanalow dzieli jego szerokosc (1, 2, 4 kanaly;
+// 8 w AVX2); inaczej calosc idzie petla skalarna. t = numer ramki w kazdym pasie.
+__attribute__((target("sse2")))
+void sse2Mix(const float* a, const float* b, float* dst, size_t frames, size_t channels, const MixGains& g) {
+    size_t f = 0;
+    if (4 % channels == 0) {
+        const size_t per = 4 / channels;
+        __m128 t = _mm_setr_ps(0.0f, static_cast<float>(1 / channels), static_cast<float>(2 / channels),
+                               static_cast<float>(3 / channels));
+        const __m128 inc = _mm_set1_ps(static_cast<float>(per));
+        const __m128 a_from = _mm_set1_ps(g.a_from), a_step = _mm_set1_ps(g.a_step);
+        const __m128 b_from = _mm_set1_ps(g.b_from), b_step = _mm_set1_ps(g.b_step);
+        for (; f + per <= frames; f += per) {
+            const size_t i = f * channels;
+            const __m128 ga = _mm_add_ps(a_from, _mm_mul_ps(a_step, t));
+            const __m128 gb = _mm_add_ps(b_from, _mm_mul_ps(b_step, t));
+            const __m128 va = _mm_mul_ps(_mm_loadu_ps(a + i), ga);
+            const __m128 vb = _mm_mul_ps(_mm_loadu_ps(b + i), gb);
+            _mm_storeu_ps(dst + i, _mm_add_ps(va, vb));
+            t = _mm_add_ps(t, inc);
+        }
+    }
+    mixTail(a, b, dst, f, frames, channels, g);
+}
+
+__attribute__((target("avx2")))
+void avx2Mix(const float* a, const float* b, float* dst, size_t frames, size_t channels, const MixGains& g) {
+    if (8 % channels != 0) {
+        sse2Mix(a, b, dst, frames, channels, g);
+        return;
+    }
+    const size_t per = 8 / channels;
+    alignas(32) float lanes[8];
+    for (size_t j = 0; j < 8; ++j) lanes[j] = static_cast<float>(j / channels);
+    __m256 t = _mm256_load_ps(lanes);
+    const __m256 inc = _mm256_set1_ps(static_cast<float>(per));
+    const __m256 a_from = _mm256_set1_ps(g.a_from), a_step = _mm256_set1_ps(g.a_step);
+    const __m256 b_from = _mm256_set1_ps(g.b_from), b_step = _mm256_set1_ps(g.b_step);
+    size_t f = 0;
+    for (; f + per <= frames; f += per) {
+        const size_t i = f * channels;
+        const __m256 ga = _mm256_add_ps(a_from, _mm256_mul_ps(a_step, t));
+        const __m256 gb = _mm256_add_ps(b_from, _mm256_mul_ps(b_step, t));
+        const __m256 va = _mm256_mul_ps(_mm256_loadu_ps(a + i), ga);
+        const __m256 vb = _mm256_mul_ps(_mm256_loadu_ps(b + i), gb);
+        _mm256_storeu_ps(dst + i, _mm256_add_ps(va, vb));
+        t = _mm256_add_ps(t, inc);
+    }
+    mixTail(a, b, dst, f, frames, channels, g);
+}
+
+#endif // PCM_SIMD_X86
+
+using Kernel = void (*)(const uint8_t*, size_t, float*);
+using MixKernel = void (*)(const float*, const float*, float*, size_t, size_t, const MixGains&);
+
+struct KernelSet {
+    Kernel k16;
+    Kernel k24;
+    MixKernel mix;
+};
+
+KernelSet kernels(PcmKernel kernel) {
+    switch (kernel) {
+#if PCM_SIMD_X86
+    case PcmKernel::Avx2: return {avx2_16, avx2_24, avx2Mix};
+    case PcmKernel::Sse2: return {sse2_16, sse2_24, sse2Mix};
+#endif
+    default: return {scalar16, scalar24, scalarMix};
+    }
+}
+
+MixGains mixGains(size_t frames, float a_from, float a_to, float b_from, float b_to) {
+    const float n = static_cast<float>(frames);
+    return {a_from, (a_to - a_from) / n, b_from, (b_to - b_from) / n};
+}
+
+PcmKernel detectKernel() {
+#if PCM_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return PcmKernel::Avx2;
+    if (__builtin_cpu_supports("sse2")) return PcmKernel::Sse2;
+#endif
+    return PcmKernel::Scalar;
+}
+
+// wybor raz, przy starcie programu - w callbacku audio tylko skok przez wskaznik
+const PcmKernel best_kernel = detectKernel();
+const KernelSet best = kernels(best_kernel);
+
+} // namespace
+
+PcmKernel pcmKernel() {
+    return best_kernel;
+}
+
+bool pcmKernelSupported(PcmKernel kernel) {
+    switch (kernel) {
+    case PcmKernel::Scalar: return true;
+    case PcmKernel::Sse2: return best_kernel == PcmKernel::Sse2 || best_kernel == PcmKernel::Avx2;
+    case PcmKernel::Avx2: return best_kernel == PcmKernel::Avx2;
+    }
+    return false;
+}
+
+const char* pcmKernelName(PcmKernel kernel) {
+    switch (kernel) {
+    case PcmKernel::Scalar: return "scalar";
+    case PcmKernel::Sse2: return "sse2";
+    case PcmKernel::Avx2: return "avx2";
+    }
+    return "?";
+}
+
+void pcmToFloat(const uint8_t* src, size_t samples, int bits, float* dst) {
+    (bits == 24 ? best.k24 : best.k16)(src, samples, dst);
+}
+
+void pcmToFloat(const uint8_t* src, size_t samples, int bits, float* dst, PcmKernel kernel) {
+    const KernelSet set = pcmKernelSupported(kernel) ? kernels(kernel) : kernels(PcmKernel::Scalar);
+    (bits == 24 ? set.k24 : set.k16)(src, samples, dst);
+}
+
+void mixCrossfade(const float* a, const float* b, float* dst, size_t frames, size_t channels,
+                  float a_from, float a_to, float b_from, float b_to) {
+    if (frames == 0 || channels == 0) return;
+    best.mix(a, b, dst, frames, channels, mixGains(frames, a_from, a_to, b_from, b_to));
+}
+
+void mixCrossfade(const float* a, const float* b, float* dst, size_t frames, size_t channels,
+                  float a_from, float a_to, float b_from, float b_to, PcmKernel kernel) {
+    if (frames == 0 || channels == 0) return;
+    const KernelSet set = pcmKernelSupported(kernel) ? kernels(kernel) : kernels(PcmKernel::Scalar);
+    set.mix(a, b, dst, frames, channels, mixGains(frames, a_from, a_to, b_from, b_to));
+}
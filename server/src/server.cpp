@@ -1,5 +1,6 @@
 #include "server.h"
 #include "wav.h"
+#include "http_router.h"
 #include <iostream>
 #include <unistd.h>
 #include <arpa/inet.h>
@@ -9,6 +10,7 @@
 #include <algorithm>
 #include <iterator>
 #include <chrono>
+#include <cmath>
 #include <sstream>
 #include <cctype>
 #include <sys/stat.h>
@@ -16,38 +18,318 @@
 #include <ctime>
 #include <dirent.h>
 #include <filesystem>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <pthread.h>
+#include <sched.h>
 
 #ifndef DEFAULT_HTTP_PORT
 #define DEFAULT_HTTP_PORT 8080
 #endif
 
-static std::string jsonEscape(const std::string& s) {
-    std::string out;
-    out.reserve(s.size() + 4);
-    for (char c : s) {
-        switch (c) {
-            case '\\': out += "\\\\"; break;
-            case '"':  out += "\\\""; break;
-            case '\n': out += "\\n";  break;
-            case '\r': out += "\\r";  break;
-            case '\t': out += "\\t";  break;
-            default:
-                if (static_cast<unsigned char>(c) < 0x20) {
-                    continue;
-                }
-                out.push_back(c);
-        }
+// liczba reaktorow (gniazd SO_REUSEPORT); 0 = po jednym na rdzen
+#ifndef HTTP_REACTORS
+#define HTTP_REACTORS 0
+#endif
+
+// kolejka accept kazdego gniazda; jadro przycina ja do net.core.somaxconn
+#ifndef HTTP_LISTEN_BACKLOG
+#define HTTP_LISTEN_BACKLOG 1024
+#endif
+
+#ifndef HTTP_WORKERS
+#define HTTP_WORKERS 4
+#endif
+
+#ifndef AUDIO_WORKERS
+#define AUDIO_WORKERS 4
+#endif
+
+// watki sluchaczy ustepuja watkom sterujacym (nice +5)
+static constexpr int LISTENER_NICE = 5;
+
+#ifndef LISTENER_MAX_LAG_MS
+#define LISTENER_MAX_LAG_MS 2000
+#endif
+
+#ifndef LISTENER_PREROLL_MS
+#define LISTENER_PREROLL_MS 1000
+#endif
+
+// staly format strumienia ciaglego /stream; utwory w innym formacie sa przeksztalcane
+#ifndef STREAM_SAMPLE_RATE
+#define STREAM_SAMPLE_RATE 44100
+#endif
+
+#ifndef STREAM_CHANNELS
+#define STREAM_CHANNELS 2
+#endif
+
+#ifndef STREAM_BITS
+#define STREAM_BITS 16
+#endif
+
+static_assert(STREAM_BITS == 16 || STREAM_BITS == 24, "STREAM_BITS must be 16 or 24");
+static_assert(STREAM_CHANNELS > 0 && STREAM_SAMPLE_RATE > 0, "invalid stream format");
+static_assert(STREAM_CHANNELS <= 8 && STREAM_SAMPLE_RATE < (1 << 20), "HLS (FLAC) allows up to 8 channels and 1048575 Hz");
+
+// stacje (mounty) oddzielone przecinkami; pierwsza obsluguje tez sciezki bez /stations/<name>
+#ifndef STATIONS
+#define STATIONS "main"
+#endif
+
+// limit wspolnego cache zmapowanych plikow WAV (bajty probek)
+#ifndef TRACK_CACHE_MB
+#define TRACK_CACHE_MB 256
+#endif
+
+// ICY: co ile bajtow ciala odpowiedzi idzie blok metadanych (icy-metaint)
+#ifndef ICY_METAINT
+#define ICY_METAINT 16000
+#endif
+
+// HLS: dlugosc segmentu i liczba segmentow na playliscie live
+#ifndef HLS_SEGMENT_MS
+#define HLS_SEGMENT_MS 4000
+#endif
+
+#ifndef HLS_SEGMENTS
+#define HLS_SEGMENTS 6
+#endif
+
+// przejscie miedzy utworami: koniec biezacego nachodzi na poczatek nastepnego; 0 = bez przerwy, bez miksu
+#ifndef CROSSFADE_MS
+#define CROSSFADE_MS 2000
+#endif
+
+#ifndef LISTENER_LAG_POLICY
+#define LISTENER_LAG_POLICY "skip"
+#endif
+
+// co ile reaktor dosyla nowe probki do sluchaczy /audio
+static constexpr long LISTENER_TICK_MS = 20;
+// krok zegara programowego stacji bez lokalnego wyjscia
+static constexpr long STATION_TICK_MS = 10;
+// segmenty HLS trzymane jeszcze po zejsciu z playlisty (klient moze je wlasnie pobierac)
+static constexpr size_t HLS_SPARE_SEGMENTS = 2;
+// segment nigdy sie nie zmienia - posrednicy moga go trzymac dlugo
+static constexpr int HLS_SEGMENT_MAX_AGE_S = 86400;
+// biezacy utwor: bloki czytane z wyprzedzeniem (~1.5 s przy 44.1 kHz/16 bit stereo)
+static constexpr size_t TRACK_BLOCK_BYTES = 64 * 1024;
+static constexpr size_t TRACK_BLOCKS = 4;
+// dlugosc przejscia i najwiekszy kawalek miksu, w ramkach strumienia ciaglego
+static constexpr size_t CROSSFADE_FRAMES = static_cast<size_t>(uint64_t(CROSSFADE_MS) * STREAM_SAMPLE_RATE / 1000);
+static constexpr size_t MIX_CHUNK_FRAMES = 1024;
+// pojemnosc wspolnego bufora PCM dla sluchaczy (~20 s dla 48 kHz/24 bit stereo)
+static constexpr size_t BROADCAST_RING_BYTES = 6 * 1024 * 1024;
+// limit czasu oczekiwania na zapis odpowiedzi do pelnego gniazda
+static constexpr int CLIENT_IO_TIMEOUT_S = 10;
+// keep-alive: bezczynne polaczenie jest zamykane po tym czasie
+static constexpr int KEEPALIVE_IDLE_S = 15;
+// keep-alive: po tylu zapytaniach odpowiadamy Connection: close
+static constexpr int KEEPALIVE_MAX_REQUESTS = 100;
+static constexpr size_t MAX_HEADER_BYTES = 16 * 1024;
+static constexpr long MAX_UPLOAD_BYTES = 75 * 1024 * 1024;
+// zapytania inne niz /upload nie potrzebuja wiekszego ciala
+static constexpr size_t MAX_FORM_BODY_BYTES = 64 * 1024;
+// tyle danych z gniazda czeka najwyzej w buforze polaczenia (takze podczas uploadu)
+static constexpr size_t MAX_READ_AHEAD = 256 * 1024;
+// sluchacz: najwiekszy chunk na ture; mniejsze porcje = czestsza kontrola zaleglosci
+static constexpr size_t LISTENER_CHUNK_BYTES = 64 * 1024;
+#if AUDIO_IO_URING
+// rozmiar kolejki zgloszen; przy wiekszej liczbie sluchaczy tick dzieli sie na kilka io_uring_enter
+static constexpr unsigned URING_ENTRIES = 4096;
+#endif
+// sluchacz: bufor nadawczy gniazda (jadro i tak go podwaja)
+static constexpr size_t LISTENER_SNDBUF_BYTES = 128 * 1024;
+// /events: co ile najczesciej wysylamy pozycje odtwarzania
+static constexpr long PROGRESS_EVENT_MS = 1000;
+// /events: subskrybent z wieksza zaleglosc jest rozlaczany
+static constexpr size_t MAX_EVENT_BACKLOG = 64 * 1024;
+
+static LagPolicy parseLagPolicy(const std::string& name) {
+    if (name == "drop") return LagPolicy::DropOldest;
+    if (name == "disconnect") return LagPolicy::Disconnect;
+    if (name != "skip")
+        std::cerr << "[SERVER] Unknown listener lag policy '" << name << "', using skip\n";
+    return LagPolicy::SkipToLive;
+}
+
+static const char* lagPolicyName(LagPolicy policy) {
+    switch (policy) {
+        case LagPolicy::DropOldest: return "drop";
+        case LagPolicy::Disconnect: return "disconnect";
+        case LagPolicy::SkipToLive: break;
     }
-    return out;
+    return "skip";
+}
+
+static int64_t steadyMillis() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
 }
 
-Server::Server(int port) : port(port) {}
+// nazwa stacji trafia do sciezki URL
+static bool validStationName(std::string_view name) {
+    if (name.empty() || name.size() > 32) return false;
+    for (char c : name)
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '-' && c != '_') return false;
+    return true;
+}
+
+Server::Server(int port)
+    : port(port),
+      control_workers(HTTP_WORKERS, "http"),
+      listener_workers(AUDIO_WORKERS, "audio", LISTENER_NICE),
+      lag_policy(parseLagPolicy(LISTENER_LAG_POLICY)),
+      stream_format{STREAM_SAMPLE_RATE, STREAM_CHANNELS, STREAM_BITS},
+      track_cache(static_cast<size_t>(TRACK_CACHE_MB) * 1024 * 1024) {
+    auto addStation = [this](std::string_view name) {
+        auto station = std::make_unique<Station>();
+        station->index = stations.size();
+        station->name = std::string(name);
+        station->local_output = station->index == 0;
+        station->broadcast = std::make_shared<BroadcastRing>(BROADCAST_RING_BYTES);
+        station->stream_ring = std::make_shared<BroadcastRing>(BROADCAST_RING_BYTES);
+        for (auto& deck : station->decks) {
+            deck = std::make_unique<Deck>(TRACK_BLOCK_BYTES, TRACK_BLOCKS);
+            deck->open(station->wav, stream_format);
+        }
+        station->mix_current.resize(MIX_CHUNK_FRAMES * stream_format.channels);
+        station->mix_next.resize(MIX_CHUNK_FRAMES * stream_format.channels);
+        station->mix_pcm.resize(MIX_CHUNK_FRAMES * stream_format.frameSize());
+        station->hls = std::make_unique<HlsSegmenter>(stream_format, HLS_SEGMENT_MS, HLS_SEGMENTS,
+                                                      HLS_SEGMENTS + HLS_SPARE_SEGMENTS);
+        stations.push_back(std::move(station));
+    };
+
+    std::string_view names = STATIONS;
+    while (!names.empty()) {
+        std::string_view name = names.substr(0, names.find(','));
+        names.remove_prefix(std::min(names.size(), name.size() + 1));
+        bool duplicate = std::any_of(stations.begin(), stations.end(),
+                                     [name](const auto& st) { return st->name == name; });
+        if (!validStationName(name) || duplicate) {
+            std::cerr << "[SERVER] Ignoring station name '" << name << "'\n";
+            continue;
+        }
+        addStation(name);
+    }
+    if (stations.empty())
+        addStation("main");
+}
 
 Server::~Server() {
     stop();
 }
 
-int portaudioCallback( // zegar odtwarzania
+// Koniec przejscia: stary utwor milknie, nastepny (decks[1 - active]) zostaje
+// biezacym. Jego bajty zagrane w czasie przejscia ida teraz do ring sluchaczy
+// /audio naraz, wiec tam kazdy utwor nadal jest w calosci i w kolejnosci.
+static void finishTransition(Station& station) {
+    const int active = station.active_deck.load(std::memory_order_relaxed);
+    Deck& incoming = *station.decks[1 - active];
+    station.decks[active]->stop();
+    station.switch_broadcast_offset.store(station.broadcast->head(), std::memory_order_relaxed);
+    incoming.flushHeld(*station.broadcast);
+    station.current_position.store(incoming.position(), std::memory_order_release);
+    station.active_deck.store(1 - active, std::memory_order_release);
+    station.next_state.store(NextTrack::Switched, std::memory_order_release);
+}
+
+// Krok zegara stacji: frames ramek strumienia ciaglego. Biezacy utwor (i w czasie
+// przejscia nastepny) daje probki float w formacie strumienia; wynik trafia do
+// stream_ring, a przy out != nullptr takze na lokalne wyjscie. Oryginalne bajty
+// utworow ida do ring sluchaczy /audio. Przejscie zaczyna sie CROSSFADE_FRAMES
+// przed koncem utworu (albo od razu po /skip), jesli nastepny jest gotowy; glosnosc
+// zmienia sie po krzywej rownej mocy (cos/sin). Czego watek stacji nie zdazyl
+// doczytac, to na wyjsciu cisza, a pozycja stoi.
+// Zwraca liczbe ramek, ktore faktycznie zagraly.
+static size_t advanceStation(Station& station, float* out, size_t frames) {
+    constexpr size_t channels = STREAM_CHANNELS;
+    constexpr size_t frame_bytes = channels * (STREAM_BITS / 8);
+    constexpr float half_pi = 1.57079632679f;
+    size_t done = 0;
+
+    while (done < frames) {
+        const int active = station.active_deck.load(std::memory_order_relaxed);
+        Deck& current = *station.decks[active];
+        Deck& next = *station.decks[1 - active];
+        NextTrack state = station.next_state.load(std::memory_order_acquire);
+        const bool skip = station.skip_requested.load(std::memory_order_relaxed) &&
+                          station.skip_requested.exchange(false, std::memory_order_acq_rel);
+
+        if (state == NextTrack::Ready) {
+            const uint64_t left = current.remainingFrames();
+            if (current.finished() || skip || left <= CROSSFADE_FRAMES) {
+                NextTrack ready = NextTrack::Ready;
+                if (station.next_state.compare_exchange_strong(ready, NextTrack::Switching, std::memory_order_acq_rel)) {
+                    state = NextTrack::Switching;
+                    station.fade_done = 0;
+                    station.fade_length = static_cast<size_t>(std::min<uint64_t>(left, CROSSFADE_FRAMES));
+                    station.switch_stream_offset.store(station.stream_ring->head(), std::memory_order_relaxed);
+                }
+            }
+        } else if (state == NextTrack::Switching && skip) {
+            station.fade_length = station.fade_done;
+        } else if (skip) {
+            current.stop();
+        }
+        if (state == NextTrack::Switching && station.fade_done >= station.fade_length) {
+            finishTransition(station);
+            continue;
+        }
+
+        size_t n = std::min(frames - done, MIX_CHUNK_FRAMES);
+        if (state == NextTrack::Switching) {
+            n = std::min(n, station.fade_length - station.fade_done);
+        } else if (state == NextTrack::Ready) {
+            // kawalek konczy sie dokladnie tam, gdzie zaczyna sie przejscie
+            const uint64_t left = current.remainingFrames();
+            if (left > CROSSFADE_FRAMES)
+                n = static_cast<size_t>(std::min<uint64_t>(n, left - CROSSFADE_FRAMES));
+        }
+
+        float* mixed = station.mix_current.data();
+        size_t produced = current.render(mixed, n, station.broadcast.get());
+        if (state == NextTrack::Switching) {
+            float* incoming = station.mix_next.data();
+            size_t got = next.render(incoming, n, nullptr);
+            std::fill(mixed + produced * channels, mixed + n * channels, 0.0f);
+            std::fill(incoming + got * channels, incoming + n * channels, 0.0f);
+            produced = std::max(produced, got);
+            const float from = static_cast<float>(station.fade_done) / station.fade_length * half_pi;
+            station.fade_done += produced;
+            const float to = static_cast<float>(station.fade_done) / station.fade_length * half_pi;
+            mixCrossfade(mixed, incoming, mixed, produced, channels,
+                         std::cos(from), std::cos(to), std::sin(from), std::sin(to));
+        }
+
+        if (produced) {
+            floatToPcm(mixed, produced * channels, STREAM_BITS, station.mix_pcm.data());
+            station.stream_ring->write(station.mix_pcm.data(), produced * frame_bytes);
+            if (out)
+                std::copy(mixed, mixed + produced * channels, out + done * channels);
+            done += produced;
+        }
+        // koniec utworu w srodku kroku: dalej gra nastepny, jesli jest gotowy
+        if (produced < n && !(current.finished() &&
+                              station.next_state.load(std::memory_order_acquire) == NextTrack::Ready))
+            break;
+    }
+    if (out)
+        std::fill(out + done * channels, out + frames * channels, 0.0f);
+
+    const Deck& current = *station.decks[station.active_deck.load(std::memory_order_relaxed)];
+    station.current_position.store(current.position(), std::memory_order_release);
+    return done;
+}
+
+// zegar odtwarzania stacji z lokalnym wyjsciem; strumien gra caly czas, takze cisze
+static int portaudioCallback(
     const void*,
     void* output,
     unsigned long framesPerBuffer,
@@ -55,44 +337,8 @@ int portaudioCallback( // zegar odtwarzania
     PaStreamCallbackFlags,
     void* userData
 ) {
-    Server* server = static_cast<Server*>(userData);
-    float* out = static_cast<float*>(output);
-
-    size_t pos = server->current_position.load(std::memory_order_acquire);
-    const int bits = server->current_wav.bitsPerSample;
-    const int sampleSize = bits / 8;
-    const int channels = server->current_wav.channels;
-    const size_t frameSize = static_cast<size_t>(sampleSize * channels);
-
-    for (unsigned long i = 0; i < framesPerBuffer; ++i) {
-        for (int ch = 0; ch < channels; ++ch) {
-            size_t byteIndex = pos + static_cast<size_t>(ch * sampleSize);
-            if (byteIndex + sampleSize <= server->current_wav.data.size()) {
-                const uint8_t* p = server->current_wav.data.data() + byteIndex;
-                float sampleOut = 0.0f;
-                if (bits == 24) {
-                    int32_t sample = (p[0]) | (p[1] << 8) | (p[2] << 16);
-                    if (sample & 0x800000) sample |= ~0xFFFFFF;
-                    sampleOut = sample / 8388608.0f;
-                } else if (bits == 16) {
-                    int16_t sample = static_cast<int16_t>(p[0] | (p[1] << 8));
-                    sampleOut = sample / 32768.0f;
-                }
-                out[i * channels + ch] = sampleOut;
-            } else {
-                out[i * channels + ch] = 0.0f;
-            }
-        }
-        pos += frameSize;
-    }
-
-    server->current_position.store(pos, std::memory_order_release);
-
-    server->playback_cv.notify_all();
-
-    return (pos >= server->current_wav.data.size())
-           ? paComplete
-           : paContinue;
+    advanceStation(*static_cast<Station*>(userData), static_cast<float*>(output), framesPerBuffer);
+    return paContinue;
 }
 
 static bool ensureDir(const std::string& path) {
@@ -142,129 +388,108 @@ static std::string sanitizeFilename(const std::string& name) {
     return out;
 }
 
-static long parseContentLength(const std::string& headers) {
-    std::istringstream iss(headers);
-    std::string line;
-    while (std::getline(iss, line)) {
-        if (line.size() && (line.back() == '\r')) line.pop_back();
-        std::string key = "Content-Length:";
-        if (line.size() >= key.size() && std::equal(key.begin(), key.end(), line.begin(), [](char a,char b){return std::tolower(a)==std::tolower(b);} )) {
-            try {
-                return std::stol(line.substr(key.size()));
-            } catch (...) { return -1; }
-        }
-    }
-    return -1;
-}
-
-static std::string parseBoundary(const std::string& headers) {
-    std::istringstream iss(headers);
-    std::string line;
-    while (std::getline(iss, line)) {
-        if (line.size() && (line.back() == '\r')) line.pop_back();
-        std::string key = "Content-Type:";
-        if (line.size() >= key.size() && std::equal(key.begin(), key.end(), line.begin(), [](char a,char b){return std::tolower(a)==std::tolower(b);} )) {
-            auto pos = line.find("boundary=");
-            if (pos != std::string::npos) {
-                std::string b = line.substr(pos + 9);
-                if (!b.empty() && b.front() == '"' && b.back() == '"') {
-                    b = b.substr(1, b.size() - 2);
-                }
-                return b;
-            }
-        }
-    }
-    return {};
-}
-
-static bool parseMultipartSingleFile(
-    const std::string& body,
-    const std::string& boundary,
-    std::string& outFilename,
-    std::string& outData
-) {
-    std::string marker = "--" + boundary;
-    size_t pos = body.find(marker);
-    if (pos == std::string::npos) return false;
-    pos += marker.size();
-    if (pos + 2 > body.size() || body.compare(pos, 2, "\r\n") != 0) return false;
-    pos += 2;
-
-    size_t header_end = body.find("\r\n\r\n", pos);
-    if (header_end == std::string::npos) return false;
-    std::string part_headers = body.substr(pos, header_end - pos);
-
-    {
-        auto dispoPos = part_headers.find("Content-Disposition:");
-        if (dispoPos == std::string::npos) return false;
-        auto fnamePos = part_headers.find("filename=", dispoPos);
-        if (fnamePos == std::string::npos) return false;
-        fnamePos += 9;
-        if (fnamePos < part_headers.size() && part_headers[fnamePos] == '"') {
-            ++fnamePos;
-            auto endq = part_headers.find('"', fnamePos);
-            if (endq == std::string::npos) return false;
-            outFilename = part_headers.substr(fnamePos, endq - fnamePos);
-        } else {
-            auto endsp = part_headers.find_first_of(";\r\n", fnamePos);
-            outFilename = part_headers.substr(fnamePos, endsp - fnamePos);
-        }
-    }
-
-    size_t data_start = header_end + 4;
-    size_t data_end = body.find("\r\n" + marker, data_start);
-    if (data_end == std::string::npos) return false;
-
-    outData.assign(body.data() + data_start, body.data() + data_end);
-    return true;
-}
-
-
 void Server::start() {
     running = true;
-    setupHttpSocket();
+    setupEventLoop();
     std::srand(static_cast<unsigned int>(std::time(nullptr)));
 
     clearUploadsDir();
 
-    enqueueTrack("audio/berdly.wav");
-    enqueueTrack("audio/wodka.wav");
+    enqueueTrack(*stations.front(), "audio/berdly.wav");
+    enqueueTrack(*stations.front(), "audio/wodka.wav");
     
     Pa_Initialize();
 
-    stream_thread = std::thread(&Server::streamingLoop, this);
-    http_thread   = std::thread(&Server::httpLoop, this);
+    for (auto& station : stations)
+        station->clock_thread = std::thread(&Server::stationLoop, this, std::ref(*station));
+    for (auto& shard : shards)
+        shard->thread = std::thread(&Server::httpLoop, this, std::ref(*shard));
 
     std::cout << "[SERVER] Started on port " << (port > 0 ? port : DEFAULT_HTTP_PORT) << "\n";
     std::cout << "[SERVER] UI: http://127.0.0.1:" << (port > 0 ? port : DEFAULT_HTTP_PORT) << "/" << "\n";
+    if (stations.size() > 1) {
+        std::cout << "[SERVER] Stations:";
+        for (auto& station : stations)
+            std::cout << " /stations/" << station->name << "/";
+        std::cout << "\n";
+    }
 }
 
 void Server::stop() {
     running = false;
 
-    stopAudioStream();
+    // lokalne wyjscie zamyka watek stacji, ktory je otworzyl
+    for (auto& station : stations)
+        if (station->clock_thread.joinable()) station->clock_thread.join();
     Pa_Terminate();
 
-    if (http_socket > 0)
-        close(http_socket);
+    for (auto& shard : shards) {
+        uint64_t one = 1;
+        ssize_t w = write(shard->wake_fd, &one, sizeof(one));
+        (void)w;
+    }
+
+    for (auto& shard : shards)
+        if (shard->thread.joinable()) shard->thread.join();
+
+    control_workers.stop();
+    listener_workers.stop();
+#if AUDIO_IO_URING
+    // najpierw pierscien (anuluje zgloszenia), potem bufory, na ktore wskazuja
+    uring.reset();
+    uring_sends.clear();
+#endif
+
+    {
+        std::lock_guard<std::mutex> lock(listeners_mutex);
+        for (auto& entry : listeners)
+            close(entry.first);
+        listeners.clear();
+    }
+    {
+        std::lock_guard<std::mutex> lock(connections_mutex);
+        for (auto& entry : connections)
+            close(entry.first);
+        connections.clear();
+    }
+    {
+        std::lock_guard<std::mutex> lock(subscribers_mutex);
+        for (auto& entry : subscribers)
+            close(entry.first);
+        subscribers.clear();
+    }
 
-    if (stream_thread.joinable()) stream_thread.join();
-    if (http_thread.joinable())   http_thread.join();
+    for (auto& shard : shards) {
+        for (int fd : {shard->listen_fd, shard->wake_fd, shard->epoll_fd})
+            if (fd >= 0) close(fd);
+    }
+    shards.clear();
+    if (tick_fd >= 0) {
+        close(tick_fd);
+        tick_fd = -1;
+    }
 
     std::cout << "[SERVER] Stopped\n";
 }
 
-void Server::setupHttpSocket() {
-    http_socket = socket(AF_INET, SOCK_STREAM, 0);
-    if (http_socket < 0) {
+// -1, gdy gniazda nie da sie otworzyc; reuse_port = kilka gniazd na tym samym porcie
+int Server::setupHttpSocket(bool reuse_port) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
         perror("http socket");
-        exit(1);
+        return -1;
     }
 
     int reuse = 1;
-    if (setsockopt(http_socket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) < 0) {
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) < 0) {
         perror("setsockopt SO_REUSEADDR");
-        exit(1);
+        close(fd);
+        return -1;
+    }
+    if (reuse_port && setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &reuse, sizeof(reuse)) < 0) {
+        perror("setsockopt SO_REUSEPORT");
+        close(fd);
+        return -1;
     }
 
     sockaddr_in addr{};
@@ -272,642 +497,1914 @@ void Server::setupHttpSocket() {
     addr.sin_addr.s_addr = inet_addr("0.0.0.0");
     addr.sin_port = htons(port > 0 ? port : DEFAULT_HTTP_PORT);
 
-    if (bind(http_socket, (sockaddr*)&addr, sizeof(addr)) < 0) {
+    if (bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
         perror("http bind");
-        exit(1);
+        close(fd);
+        return -1;
     }
 
-    if (listen(http_socket, 5) < 0) {
+    if (listen(fd, HTTP_LISTEN_BACKLOG) < 0) {
         perror("http listen");
-        exit(1);
+        close(fd);
+        return -1;
     }
+    return fd;
 }
 
-void Server::httpLoop() {
-    while (running) {
-        sockaddr_in client_addr{};
-        socklen_t len = sizeof(client_addr);
-
-        int client = accept(http_socket, (sockaddr*)&client_addr, &len);
-        if (client < 0)
-            continue;
-
-        std::thread([this, client]() {
-            handleHttpClient(client);
-        }).detach();
-    }
+static int readSomaxconn() {
+    std::ifstream f("/proc/sys/net/core/somaxconn");
+    int value = -1;
+    f >> value;
+    return value;
 }
 
-void Server::sendHttpResponse(int client, const std::string& body, const std::string& contentType, int status) {
-    const char* statusText = status == 200 ? "OK" : (status == 404 ? "Not Found" : "OK");
-    std::string header =
-        "HTTP/1.1 " + std::to_string(status) + " " + statusText + "\r\n" +
-        "Content-Type: " + contentType + "\r\n" +
-        "Content-Length: " + std::to_string(body.size()) + "\r\n" +
-        "Connection: close\r\n\r\n";
+void Server::setupEventLoop() {
+    size_t count = HTTP_REACTORS > 0 ? HTTP_REACTORS : std::max(1u, std::thread::hardware_concurrency());
 
-    send(client, header.c_str(), header.size(), 0);
-    send(client, body.c_str(), body.size(), 0);
-    close(client);
-}
+    for (size_t i = 0; i < count; ++i) {
+        int listen_fd = setupHttpSocket(count > 1);
+        if (listen_fd < 0 && i == 0 && count > 1) {
+            // jadro bez SO_REUSEPORT - jeden reaktor jak dawniej
+            count = 1;
+            listen_fd = setupHttpSocket(false);
+        }
+        if (listen_fd < 0) {
+            if (i == 0) exit(1);
+            std::cerr << "[SERVER] Only " << i << " of " << count << " reactors could listen\n";
+            break;
+        }
 
-void Server::handleHttpClient(int client) {
-    char buffer[4096];
-    ssize_t n = recv(client, buffer, sizeof(buffer) - 1, 0);
-    if (n <= 0) {
-        close(client);
-        return;
+        auto shard = std::make_unique<ReactorShard>();
+        shard->index = i;
+        shard->listen_fd = listen_fd;
+        shard->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        shard->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (shard->epoll_fd < 0 || shard->wake_fd < 0) {
+            perror("event loop");
+            exit(1);
+        }
+        for (int fd : {shard->listen_fd, shard->wake_fd}) {
+            epoll_event ev{};
+            ev.events = EPOLLIN;
+            ev.data.fd = fd;
+            if (epoll_ctl(shard->epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+                perror("epoll_ctl");
+                exit(1);
+            }
+        }
+        shards.push_back(std::move(shard));
     }
-    buffer[n] = '\0';
 
-    std::string request(buffer);
+    int somaxconn = readSomaxconn();
+    std::cout << "[SERVER] " << shards.size() << " reactor(s), listen backlog " << HTTP_LISTEN_BACKLOG;
+    if (somaxconn > 0 && somaxconn < HTTP_LISTEN_BACKLOG)
+        std::cout << " (capped by net.core.somaxconn=" << somaxconn << ")";
+    std::cout << "\n";
 
-    size_t header_end = request.find("\r\n\r\n");
-    std::string headers = header_end != std::string::npos ? request.substr(0, header_end) : request;
-    std::string body = header_end != std::string::npos ? request.substr(header_end + 4) : std::string();
+    int epoll_fd = shards.front()->epoll_fd;
+    tick_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (tick_fd < 0) {
+        perror("event loop");
+        exit(1);
+    }
 
-    long content_length = parseContentLength(headers);
-    std::string boundary = parseBoundary(headers);
+    itimerspec tick{};
+    tick.it_interval.tv_nsec = LISTENER_TICK_MS * 1000000L;
+    tick.it_value = tick.it_interval;
+    timerfd_settime(tick_fd, 0, &tick, nullptr);
 
-    // sprawdzamy poprawnosc naglowka
-    size_t method_end = headers.find(' ');
-    if (method_end == std::string::npos) {
-        close(client);
-        return;
-    }
-    size_t path_end = headers.find(' ', method_end + 1);
-    if (path_end == std::string::npos) {
-        close(client);
-        return;
+    epoll_event tick_ev{};
+    tick_ev.events = EPOLLIN;
+    tick_ev.data.fd = tick_fd;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, tick_fd, &tick_ev) < 0) {
+        perror("epoll_ctl");
+        exit(1);
     }
 
-    std::string method = headers.substr(0, method_end);
-    std::string path = headers.substr(method_end + 1, path_end - method_end - 1);
+#if AUDIO_IO_URING
+    uring = std::make_unique<UringSender>(URING_ENTRIES);
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = uring->eventFd();
+    if (!uring->ok() || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, uring->eventFd(), &ev) < 0) {
+        std::cerr << "[SERVER] io_uring unavailable, listeners use epoll + writev\n";
+        uring.reset();
+    } else {
+        std::cout << "[SERVER] Listener fan-out via io_uring\n";
+    }
+#endif
+}
 
-    auto trim = [](std::string s) {
-        while (!s.empty() && (s.back() == '\r' || s.back() == '\n' || s.back() == ' ' || s.back() == '\t')) s.pop_back();
-        size_t i = 0;
-        while (i < s.size() && (s[i] == ' ' || s[i] == '\t')) ++i;
-        return s.substr(i);
-    };
+// reaktor: watek shardu czeka na zdarzenia swoich gniazd; zapytania trafiaja
+// do control_workers, dosylanie audio do listener_workers
+void Server::httpLoop(ReactorShard& shard) {
+    std::string thread_name = "reactor-" + std::to_string(shard.index);
+    pthread_setname_np(pthread_self(), thread_name.c_str());
+    if (HTTP_REACTORS == 0) {
+        // tryb "po jednym na rdzen": reaktor zostaje na swoim rdzeniu
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(shard.index % CPU_SETSIZE, &cpus);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    }
 
-    auto listWavFiles = [](const std::string& dir, const std::string& prefix) {
-        std::vector<std::string> files;
-        DIR* dp = opendir(dir.c_str());
-        if (!dp) return files;
-        struct dirent* ent;
-        while ((ent = readdir(dp)) != nullptr) {
-            const char* name = ent->d_name;
-            if (std::strcmp(name, ".") == 0 || std::strcmp(name, "..")==0) continue;
-            std::string fname = name;
-            auto pos = fname.find_last_of('.');
-            if (pos == std::string::npos) continue;
-            std::string ext = fname.substr(pos + 1);
-            std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c){ return std::tolower(c); });
-            if (ext == "wav") {
-                files.push_back(prefix + fname);
-            }
-        }
-        closedir(dp);
-        std::sort(files.begin(), files.end());
-        return files;
-    };
+    epoll_event events[64];
 
-    if (path == "/upload" && method == "POST") {
-        const long MAX_UPLOAD = 75 * 1024 * 1024;
-        if (content_length < 0 || content_length > MAX_UPLOAD) {
-            sendHttpResponse(client, "{\"error\":\"invalid content-length\"}", "application/json", 400);
-            return;
-        }
-        if (boundary.empty()) {
-            sendHttpResponse(client, "{\"error\":\"missing boundary\"}", "application/json", 400);
-            return;
+    while (running) {
+        int n = epoll_wait(shard.epoll_fd, events, 64, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait");
+            break;
         }
 
-        while (static_cast<long>(body.size()) < content_length) {
-            char chunk[4096];
-            ssize_t r = recv(client, chunk, sizeof(chunk), 0);
-            if (r <= 0) break;
-            body.append(chunk, static_cast<size_t>(r));
-        }
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
 
-        if (static_cast<long>(body.size()) < content_length) {
-            sendHttpResponse(client, "{\"error\":\"incomplete upload\"}", "application/json", 400);
-            return;
-        }
+            if (fd == shard.wake_fd) {
+                uint64_t v;
+                while (read(shard.wake_fd, &v, sizeof(v)) > 0) {}
+                continue;
+            }
+            if (fd == shard.listen_fd) {
+                acceptClients(shard);
+                continue;
+            }
+#if AUDIO_IO_URING
+            if (uring && fd == uring->eventFd()) {
+                uint64_t v;
+                while (read(fd, &v, sizeof(v)) > 0) {}
+                reapUringSends();
+                continue;
+            }
+#endif
+            if (fd == tick_fd) {
+                uint64_t v;
+                while (read(tick_fd, &v, sizeof(v)) > 0) {}
+                pumpListeners();
+                publishEvents();
+                sweepIdleConnections();
+                continue;
+            }
 
-        std::thread([this, body, boundary]() {
-            std::string filename;
-            std::string filedata;
-            if (!parseMultipartSingleFile(body, boundary, filename, filedata)) {
-                std::cerr << "[UPLOAD] Failed to parse multipart data\n";
-                return;
+            std::shared_ptr<AudioListener> listener;
+            {
+                std::lock_guard<std::mutex> lock(listeners_mutex);
+                auto it = listeners.find(fd);
+                if (it != listeners.end()) listener = it->second;
             }
 
-            filename = sanitizeFilename(filename);
-            
-            const char* uploadDir = "uploads";
-            if (!ensureDir(uploadDir)) {
-                std::cerr << "[UPLOAD] Cannot create uploads directory at " << uploadDir << "\n";
-                return;
+            if (listener) {
+                // gniazdo znow przyjmuje dane albo zostalo zamkniete po drugiej stronie;
+                // fd jest uzbrojone tylko po EAGAIN, a busy zostaje wtedy ustawione
+                listener_workers.submit([this, listener]{ pumpListener(listener); });
+                continue;
             }
 
-            std::string outPath = std::string(uploadDir) + "/" + filename;
-            std::ofstream ofs(outPath, std::ios::binary);
-            if (!ofs) {
-                std::cerr << "[UPLOAD] Cannot open file for writing: " << outPath 
-                          << " (cwd: " << std::filesystem::current_path().string() << ")\n";
-                return;
+            std::shared_ptr<EventSubscriber> sub;
+            {
+                std::lock_guard<std::mutex> lock(subscribers_mutex);
+                auto it = subscribers.find(fd);
+                if (it != subscribers.end()) sub = it->second;
             }
-            ofs.write(filedata.data(), static_cast<std::streamsize>(filedata.size()));
-            ofs.close();
 
-            int id = enqueueTrack(outPath);
-            // playback_cv.notify_all();
+            if (sub) {
+                // EPOLLOUT po EAGAIN albo klient zamknal/wyslal cos na strumien zdarzen
+                control_workers.submit([this, sub]{
+                    char scratch[256];
+                    ssize_t r = recv(sub->fd, scratch, sizeof(scratch), MSG_DONTWAIT);
+                    if (r == 0 || (r < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+                        dropSubscriber(sub->fd);
+                        return;
+                    }
+                    flushSubscriber(sub);
+                });
+                continue;
+            }
 
-            std::cout << "[UPLOAD] Saved " << outPath << " (" << filedata.size() << " bytes), enqueued as #" << id << "\n";
-        }).detach();
+            std::shared_ptr<HttpConnection> conn;
+            {
+                std::lock_guard<std::mutex> lock(connections_mutex);
+                auto it = connections.find(fd);
+                if (it != connections.end()) conn = it->second;
+            }
 
-        sendHttpResponse(client, "{\"status\":\"processing\"}", "application/json", 202);
-        return;
+            if (conn && !conn->busy.exchange(true))
+                control_workers.submit([this, conn]{ handleHttpClient(conn); });
+        }
     }
+}
 
-    if (path == "/library" && method == "GET") {
-        auto audioFiles = listWavFiles("audio", "audio/");
-        auto uploadFiles = listWavFiles("uploads", "uploads/");
+void Server::acceptClients(ReactorShard& shard) {
+    while (true) {
+        sockaddr_in client_addr{};
+        socklen_t len = sizeof(client_addr);
 
-        std::string body = "{\"audio\":[";
-        for (size_t i = 0; i < audioFiles.size(); ++i) {
-            body += "\"" + jsonEscape(audioFiles[i]) + "\"";
-            if (i + 1 < audioFiles.size()) body += ",";
+        int client = accept4(shard.listen_fd, (sockaddr*)&client_addr, &len, SOCK_CLOEXEC | SOCK_NONBLOCK);
+        if (client < 0) {
+            if (errno == EINTR) continue;
+            return; // EAGAIN - kolejka accept oprozniona
         }
-        body += "],\"uploads\":[";
-        for (size_t i = 0; i < uploadFiles.size(); ++i) {
-            body += "\"" + jsonEscape(uploadFiles[i]) + "\"";
-            if (i + 1 < uploadFiles.size()) body += ",";
+
+        shard.accepted.fetch_add(1, std::memory_order_relaxed);
+
+        auto conn = std::make_shared<HttpConnection>();
+        conn->fd = client;
+        conn->epoll_fd = shard.epoll_fd;
+        conn->parser = HttpParser(MAX_HEADER_BYTES, MAX_UPLOAD_BYTES);
+        conn->last_active = std::chrono::steady_clock::now();
+        {
+            std::lock_guard<std::mutex> lock(connections_mutex);
+            connections[client] = conn;
         }
-        body += "]}";
 
-        sendHttpResponse(client, body, "application/json", 200);
-        return;
+        // ONESHOT: zapytanie trafia do dokladnie jednego workera
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+        ev.data.fd = client;
+        if (epoll_ctl(shard.epoll_fd, EPOLL_CTL_ADD, client, &ev) < 0) {
+            perror("epoll_ctl client");
+            closeConnection(client);
+        }
     }
+}
 
-    if (path == "/" || path == "/index.html") {
-        std::ifstream f("public/index.html", std::ios::binary);
-        if (!f) {
-            sendHttpResponse(client, "index not found", "text/plain", 404);
-            return;
-        }
-        std::string body((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
-        sendHttpResponse(client, body, "text/html", 200);
-        return;
+void Server::closeConnection(int fd) {
+    {
+        std::lock_guard<std::mutex> lock(connections_mutex);
+        if (connections.erase(fd) == 0) return;
     }
+    close(fd);
+}
 
-    if (path == "/progress") {
-        double duration = 0.0;
-        double elapsed = 0.0;
-        double position = 0.0;
-        std::string filename;
+// wywolywane z watku reaktora; polaczenia z busy == true sa wlasnie obslugiwane
+void Server::sweepIdleConnections() {
+    auto now = std::chrono::steady_clock::now();
+    if (now - last_idle_sweep < std::chrono::seconds(1)) return;
+    last_idle_sweep = now;
 
-        {
-            std::lock_guard<std::mutex> lock(playback_mutex);
-            if (current_wav.sampleRate > 0 && current_wav.channels > 0 && current_wav.bitsPerSample > 0) {
-                double bytesPerSecond = current_wav.sampleRate * current_wav.channels * (current_wav.bitsPerSample / 8.0);
-                duration = current_wav.data.size() / bytesPerSecond;
-                size_t pos = current_position.load(std::memory_order_acquire);
-                elapsed = pos / bytesPerSecond;
-                if (duration > 0.0)
-                    position = elapsed / duration;
-                filename = current_track_name;
-            }
+    std::vector<int> idle;
+    {
+        std::lock_guard<std::mutex> lock(connections_mutex);
+        for (auto& entry : connections) {
+            auto& conn = entry.second;
+            if (conn->busy.load()) continue;
+            // niedoslana odpowiedz: klient tyle nie odbiera - jak limit czasu wysylki
+            auto limit = std::chrono::seconds(conn->sending() ? CLIENT_IO_TIMEOUT_S : KEEPALIVE_IDLE_S);
+            if (now - conn->last_active > limit)
+                idle.push_back(entry.first);
         }
-
-        std::string body =
-            "{\"position\":" + std::to_string(position) +
-            ",\"elapsed\":" + std::to_string(elapsed) +
-            ",\"duration\":" + std::to_string(duration) +
-            ",\"filename\":\"" + filename + "\"}";
-        sendHttpResponse(client, body, "application/json", 200);
-        return;
     }
+    for (int fd : idle)
+        closeConnection(fd);
+}
 
-    if (path == "/skip") {
-        if (method == "POST")
-            skip_requested = true;
-        sendHttpResponse(client, "{\"status\":\"skip\"}", "application/json", 200);
-        return;
+// Gniazda klientow sa nieblokujace: wysyla tyle, ile gniazdo przyjmie, i przesuwa
+// iov/count za wyslane bajty. false = blad gniazda; count > 0 = bufor gniazda pelny.
+static bool send_iov(int sock, iovec*& iov, int& count) {
+    while (count > 0) {
+        msghdr msg{};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = static_cast<size_t>(count);
+        ssize_t s = sendmsg(sock, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (s < 0 && errno == EINTR) continue;
+        if (s < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+        if (s <= 0) return false;
+        size_t sent = static_cast<size_t>(s);
+        while (count > 0 && sent >= iov->iov_len) {
+            sent -= iov->iov_len;
+            ++iov;
+            --count;
+        }
+        if (count > 0) {
+            iov->iov_base = static_cast<char*>(iov->iov_base) + sent;
+            iov->iov_len -= sent;
+        }
     }
+    return true;
+}
 
-    if (path == "/queue") {
-        if (method == "GET") {
-            std::string body = "{\"queue\": [";
-            {
-                std::lock_guard<std::mutex> lock(playlist_mutex);
-                for (size_t i = 0; i < playlist.size(); ++i) {
-                    body += "{\"id\":" + std::to_string(playlist[i].id) + ",\"index\":" + std::to_string(i) + ",\"file\":\"" + playlist[i].filename + "\"}";
-                    if (i + 1 < playlist.size()) body += ",";
-                }
+// Naglowek w buforze polaczenia, cialo bez kopiowania - oba jednym sendmsg,
+// wiec mala odpowiedz to jeden segment TCP zamiast dwoch.
+void Server::sendHttpResponse(HttpConnection& client, std::string_view body, std::string_view contentType, int status) {
+    HttpResponse& res = client.response;
+    res.start(status);
+    res.header("Content-Type", contentType);
+    res.header("Content-Length", body.size());
+    res.endHeaders(client.keep_alive, KEEPALIVE_IDLE_S, KEEPALIVE_MAX_REQUESTS - client.requests);
+    sendPrepared(client, body);
+}
+
+// Naglowek zlozony juz w client.response + cialo. Worker nie czeka na pelne
+// gniazdo: reszta zostaje w polaczeniu, a handleHttpClient dosle ja po EPOLLOUT.
+void Server::sendPrepared(HttpConnection& client, std::string_view body, std::shared_ptr<const void> owner) {
+    HttpResponse& res = client.response;
+    iovec iov[2];
+    iov[0].iov_base = const_cast<char*>(res.head().data());
+    iov[0].iov_len = res.head().size();
+    iov[1].iov_base = const_cast<char*>(body.data());
+    iov[1].iov_len = body.size();
+    iovec* rest = iov;
+    int count = 2;
+    if (!send_iov(client.fd, rest, count)) {
+        client.keep_alive = false;
+    } else if (count > 0) {
+        // bufor naglowka jest wielokrotnego uzytku, a cialo bez wlasciciela moze
+        // nie przezyc handlera - kopiujemy; z wlascicielem trzymamy tylko wskaznik
+        client.out.clear();
+        client.out_offset = 0;
+        if (rest == iov) {
+            client.out.assign(static_cast<const char*>(iov[0].iov_base), iov[0].iov_len);
+            ++rest;
+            --count;
+        }
+        if (count > 0) {
+            std::string_view tail(static_cast<const char*>(rest->iov_base), rest->iov_len);
+            if (owner) {
+                client.out_body = tail;
+                client.out_owner = std::move(owner);
+            } else {
+                client.out.append(tail);
             }
-            body += "]}";
-            sendHttpResponse(client, body, "application/json", 200);
-            return;
         }
+    }
+    res.trim();
+}
 
-        if (method == "POST") {
-            std::string fname = trim(body);
-            size_t nl = fname.find_first_of("\r\n");
-            if (nl != std::string::npos) fname = fname.substr(0, nl);
-            if (fname.empty()) {
-                sendHttpResponse(client, "{\"error\":\"filename required\"}", "application/json", 400);
-                return;
-            }
+// Dosyla odlozona odpowiedz; false = blad gniazda.
+bool Server::flushResponse(HttpConnection& client) {
+    iovec iov[2];
+    int count = 0;
+    if (client.out_offset < client.out.size()) {
+        iov[count].iov_base = client.out.data() + client.out_offset;
+        iov[count].iov_len = client.out.size() - client.out_offset;
+        ++count;
+    }
+    if (!client.out_body.empty()) {
+        iov[count].iov_base = const_cast<char*>(client.out_body.data());
+        iov[count].iov_len = client.out_body.size();
+        ++count;
+    }
+    iovec* rest = iov;
+    const size_t before = (client.out.size() - client.out_offset) + client.out_body.size();
+    if (!send_iov(client.fd, rest, count))
+        return false;
+    size_t left = 0;
+    for (int i = 0; i < count; ++i) left += rest[i].iov_len;
+    size_t sent = before - left;
+    size_t from_out = std::min(sent, client.out.size() - client.out_offset);
+    client.out_offset += from_out;
+    client.out_body.remove_prefix(sent - from_out);
+    if (!client.sending()) {
+        client.out.clear();
+        client.out_offset = 0;
+        client.out_body = {};
+        client.out_owner.reset();
+    }
+    return true;
+}
 
-            struct stat st{};
-            if (stat(fname.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
-                sendHttpResponse(client, "{\"error\":\"file not found on server\"}", "application/json", 400);
-                return;
-            }
+// Cialo zlozone wczesniej w client.response.beginBody() (JsonWriter).
+void Server::sendJson(HttpConnection& client, int status) {
+    sendHttpResponse(client, client.response.body(), "application/json", status);
+}
 
-            int id = enqueueTrack(fname);
-            // playback_cv.notify_all();
-            sendHttpResponse(client, "{\"enqueued\":" + std::to_string(id) + ",\"file\":\"" + fname + "\"}", "application/json", 200);
-            return;
-        }
+// Plik z pamieci podrecznej: wariant gzip wg Accept-Encoding, 304 gdy klient ma
+// juz te wersje. Naglowek i cialo ida jednym sendmsg.
+void Server::sendStaticAsset(HttpConnection& client, const HttpRequest& request, const StaticAsset& asset) {
+    bool gzip = !asset.gzip_body.empty() && acceptsEncoding(request.header("Accept-Encoding"), "gzip");
+    const std::string& body = gzip ? asset.gzip_body : asset.body;
+    const std::string& etag = gzip ? asset.gzip_etag : asset.etag;
+
+    std::string_view inm = request.header("If-None-Match");
+    bool not_modified = !inm.empty() && etagMatches(inm, etag);
+
+    HttpResponse& res = client.response;
+    res.start(not_modified ? 304 : 200);
+    res.header("ETag", etag);
+    res.header("Cache-Control", "no-cache");
+    res.header("Vary", "Accept-Encoding");
+    if (!not_modified) {
+        res.header("Content-Type", asset.content_type);
+        if (gzip) res.header("Content-Encoding", "gzip");
+        res.header("Content-Length", body.size());
     }
+    res.endHeaders(client.keep_alive, KEEPALIVE_IDLE_S, KEEPALIVE_MAX_REQUESTS - client.requests);
+    sendPrepared(client, not_modified ? std::string_view() : std::string_view(body));
+}
 
-    if (path == "/queue/move" && method == "POST") {
-        int from = -1, to = -1;
-        {
-            std::istringstream iss(trim(body));
-            std::string token;
-            while (std::getline(iss, token, '&')) {
-                size_t eq = token.find('=');
-                if (eq != std::string::npos) {
-                    std::string key = token.substr(0, eq);
-                    std::string val = token.substr(eq + 1);
-                    if (key == "from") from = std::stoi(val);
-                    if (key == "to") to = std::stoi(val);
-                }
-            }
-        }
+void Server::handleHttpClient(const std::shared_ptr<HttpConnection>& conn) {
+    bool close_conn = false;
+    bool drained = false;
+    char buffer[16384];
 
-        if (from < 0 || to < 0) {
-            sendHttpResponse(client, "{\"error\":\"missing from/to parameters\"}", "application/json", 400);
+    if (conn->sending()) {
+        // EPOLLOUT: najpierw reszta poprzedniej odpowiedzi, kolejne zapytania czekaja
+        if (!flushResponse(*conn) || (!conn->sending() && conn->close_after_send)) {
+            closeConnection(conn->fd);
+            return;
+        }
+        if (conn->sending()) {
+            conn->last_active = std::chrono::steady_clock::now();
+            waitHttpEvent(*conn);
             return;
         }
+    }
 
-        {
-            std::lock_guard<std::mutex> lock(playlist_mutex);
-            if (static_cast<size_t>(from) >= playlist.size() || static_cast<size_t>(to) >= playlist.size()) {
-                sendHttpResponse(client, "{\"error\":\"index out of range\"}", "application/json", 400);
-                return;
+    while (!drained && !close_conn && !conn->detached && !conn->sending()) {
+        // czytamy porcjami, zeby cialo uploadu nie zalegalo w buforze polaczenia
+        while (conn->in.size() - conn->in_start < MAX_READ_AHEAD) {
+            ssize_t n = recv(conn->fd, buffer, sizeof(buffer), 0);
+            if (n > 0) {
+                conn->in.append(buffer, static_cast<size_t>(n));
+                continue;
             }
+            if (n < 0 && errno == EINTR) continue;
+            if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+                close_conn = true; // klient zamknal polaczenie - dokonczymy to, co juz przyszlo
+            drained = true;
+            break;
+        }
 
-            auto it = playlist.begin();
-            std::advance(it, from);
-            Track track = *it;
-            playlist.erase(it);
+        if (!serveBufferedRequests(*conn))
+            close_conn = true;
 
-            it = playlist.begin();
-            std::advance(it, to);
-            playlist.insert(it, track);
+        // jedno przesuniecie bufora na ture zamiast na kazde zapytanie
+        if (conn->in_start) {
+            conn->in.erase(0, conn->in_start);
+            conn->in_start = 0;
         }
+    }
 
-        sendHttpResponse(client, "{\"status\":\"moved\",\"from\":" + std::to_string(from) + ",\"to\":" + std::to_string(to) + "}", "application/json", 200);
+    if (conn->detached)
+        return; // gniazdo nalezy teraz do sluchacza /audio
+
+    if (close_conn && !conn->sending()) {
+        closeConnection(conn->fd);
         return;
     }
 
-    if (path == "/queue/remove" && method == "POST") {
-        int index = -1;
-        {
-            std::istringstream iss(trim(body));
-            std::string token;
-            while (std::getline(iss, token, '&')) {
-                size_t eq = token.find('=');
-                if (eq != std::string::npos) {
-                    std::string key = token.substr(0, eq);
-                    std::string val = token.substr(eq + 1);
-                    if (key == "index") index = std::stoi(val);
-                }
+    // odpowiedz nie zmiescila sie w gniezdzie - polaczenie zamykamy dopiero po niej
+    conn->close_after_send = close_conn;
+    conn->last_active = std::chrono::steady_clock::now();
+    waitHttpEvent(*conn);
+}
+
+// Oddaje polaczenie reaktorowi: nastepne zapytanie (EPOLLIN) albo miejsce
+// w gniezdzie na reszte odpowiedzi (EPOLLOUT). Po tym polaczenie nie jest juz nasze.
+void Server::waitHttpEvent(HttpConnection& conn) {
+    epoll_event ev{};
+    ev.events = (conn.sending() ? EPOLLOUT : EPOLLIN) | EPOLLRDHUP | EPOLLONESHOT;
+    ev.data.fd = conn.fd;
+    const int fd = conn.fd;
+    const int epoll_fd = conn.epoll_fd;
+    conn.busy = false;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &ev) < 0)
+        closeConnection(fd);
+}
+
+// Zapytania potokowe obslugujemy po kolei, odpowiedzi ida w tej samej kolejnosci.
+// Zwraca false, gdy polaczenie trzeba zamknac.
+bool Server::serveBufferedRequests(HttpConnection& conn) {
+    while (!conn.detached && !conn.sending()) {
+        if (conn.upload) {
+            // cialo /upload idzie prosto do parsera multipart i na dysk
+            size_t take = std::min(conn.in.size() - conn.in_start, conn.upload_remaining);
+            if (take) {
+                conn.upload->feed(conn.in.data() + conn.in_start, take);
+                conn.in_start += take;
+                conn.upload_remaining -= take;
             }
+            if (conn.upload_remaining > 0)
+                return true;
+            finishUpload(conn);
+            if (!conn.keep_alive)
+                return false;
+            continue;
         }
 
-        if (index < 0) {
-            sendHttpResponse(client, "{\"error\":\"missing index parameter\"}", "application/json", 400);
-            return;
+        std::string_view pending(conn.in);
+        pending.remove_prefix(conn.in_start);
+
+        HttpParser::Status status = conn.parser.parse(pending);
+        if (status == HttpParser::Status::Error) {
+            conn.keep_alive = false;
+            sendHttpResponse(conn, "{\"error\":\"bad request\"}", "application/json", conn.parser.errorStatus());
+            return false;
         }
 
-        {
-            std::lock_guard<std::mutex> lock(playlist_mutex);
-            if (static_cast<size_t>(index) >= playlist.size()) {
-                sendHttpResponse(client, "{\"error\":\"index out of range\"}", "application/json", 400);
-                return;
+        if (conn.parser.headersComplete()) {
+            const HttpRequest& req = conn.parser.request();
+            std::string_view path = req.path;
+            Station* station = resolveStation(path);
+            if (req.method == "POST" && station && path == "/upload") {
+                conn.upload_station = station;
+                ++conn.requests;
+                conn.keep_alive = running && conn.requests < KEEPALIVE_MAX_REQUESTS && req.keep_alive;
+                if (!beginUpload(conn, req))
+                    return false;
+                conn.in_start += conn.parser.bodyOffset();
+                conn.parser.reset();
+                continue;
+            }
+            if (req.content_length > static_cast<long>(MAX_FORM_BODY_BYTES)) {
+                conn.keep_alive = false;
+                sendHttpResponse(conn, "{\"error\":\"request body too large\"}", "application/json", 413);
+                return false;
             }
-
-            auto it = playlist.begin();
-            std::advance(it, index);
-            playlist.erase(it);
         }
 
-        sendHttpResponse(client, "{\"status\":\"removed\",\"index\":" + std::to_string(index) + "}", "application/json", 200);
-        return;
-    }
+        if (status == HttpParser::Status::NeedMore)
+            return true;
 
-    // get audio
-    if (path == "/audio") {
-        if (method == "GET") {
-            streamHttpAudio(client);
-            return;
-        }
-    }
+        const HttpRequest& req = conn.parser.request();
+        ++conn.requests;
+        conn.keep_alive = running
+            && conn.requests < KEEPALIVE_MAX_REQUESTS
+            && req.keep_alive;
 
-    sendHttpResponse(client, "Not Found", "text/plain", 404);
-}
- 
-int Server::enqueueTrack(const std::string& filename) {
-    std::lock_guard<std::mutex> lock(playlist_mutex);
-    int id = next_track_id++;
-    playlist.push_back({id, filename});
-    return id;
-}
+        handleHttpRequest(conn, req);
 
-static bool send_all(int sock, const uint8_t* data, size_t len) {
-    size_t sent_total = 0;
-    while (sent_total < len) {
-        ssize_t s = send(sock, data + sent_total, len - sent_total, 0);
-        if (s <= 0) return false;
-        sent_total += static_cast<size_t>(s);
+        conn.in_start += conn.parser.consumed();
+        conn.parser.reset();
+
+        if (!conn.keep_alive)
+            return false;
     }
     return true;
 }
 
-void Server::streamHttpAudio(int client) {
-    std::vector<uint8_t> data;
-    int sampleRate = 0;
-    int channels = 0;
-    int bits = 0;
-    size_t start_pos = 0;
+bool Server::beginUpload(HttpConnection& conn, const HttpRequest& req) {
+    std::string_view boundary = multipartBoundary(req.header("Content-Type"));
+    if (req.content_length < 0 || req.content_length > MAX_UPLOAD_BYTES) {
+        conn.keep_alive = false;
+        sendHttpResponse(conn, "{\"error\":\"invalid content-length\"}", "application/json", 400);
+        return false;
+    }
+    if (boundary.empty()) {
+        conn.keep_alive = false;
+        sendHttpResponse(conn, "{\"error\":\"missing boundary\"}", "application/json", 400);
+        return false;
+    }
+
+    conn.upload_remaining = static_cast<size_t>(req.content_length);
+    conn.upload = std::make_unique<MultipartFileStream>(boundary, [](const std::string& name) {
+        const char* uploadDir = "uploads";
+        if (!ensureDir(uploadDir)) {
+            std::cerr << "[UPLOAD] Cannot create uploads directory at " << uploadDir
+                      << " (cwd: " << std::filesystem::current_path().string() << ")\n";
+            return std::string();
+        }
+        return std::string(uploadDir) + "/" + sanitizeFilename(name);
+    });
+    return true;
+}
+
+void Server::finishUpload(HttpConnection& conn) {
+    std::unique_ptr<MultipartFileStream> upload = std::move(conn.upload);
+
+    if (!upload->finish()) {
+        std::cerr << "[UPLOAD] Failed: " << upload->error() << "\n";
+        JsonWriter(conn.response.beginBody()).beginObject().field("error", upload->error()).endObject();
+        sendJson(conn, 400);
+        return;
+    }
+
+    library.invalidate("uploads");
+    Station& station = *conn.upload_station;
+    int id = enqueueTrack(station, upload->path());
+    std::cout << "[UPLOAD] Saved " << upload->path() << " (" << upload->bytesWritten() << " bytes), enqueued as #" << id
+              << " on " << station.name << "\n";
+
+    JsonWriter(conn.response.beginBody())
+        .beginObject()
+        .field("status", "uploaded")
+        .field("enqueued", id)
+        .field("file", upload->path())
+        .field("bytes", static_cast<uint64_t>(upload->bytesWritten()))
+        .endObject();
+    sendJson(conn);
+}
+
+static std::string_view trimBody(std::string_view s) {
+    while (!s.empty() && (s.back() == '\r' || s.back() == '\n' || s.back() == ' ' || s.back() == '\t')) s.remove_suffix(1);
+    size_t i = 0;
+    while (i < s.size() && (s[i] == ' ' || s[i] == '\t')) ++i;
+    return s.substr(i);
+}
+
+// Wszystkie trasy w jednym miejscu; tablica i jej hasz powstaja w czasie kompilacji.
+// /upload nie ma tu wpisu - cialo idzie strumieniowo juz po naglowkach (serveBufferedRequests).
+struct Server::Routes {
+    static constexpr Route<RouteHandler> list[] = {
+        {"GET",  "/",             &Server::handleIndex},
+        {"GET",  "/index.html",   &Server::handleIndex},
+        {"GET",  "/library",      &Server::handleLibrary},
+        {"GET",  "/progress",     &Server::handleProgress},
+        {"GET",  "/stats",        &Server::handleStats},
+        {"GET",  "/events",       &Server::handleEvents},
+        {"GET",  "/skip",         &Server::handleSkip},
+        {"POST", "/skip",         &Server::handleSkip},
+        {"GET",  "/queue",        &Server::handleQueueList},
+        {"POST", "/queue",        &Server::handleQueueAdd},
+        {"POST", "/queue/move",   &Server::handleQueueMove},
+        {"POST", "/queue/remove", &Server::handleQueueRemove},
+        {"GET",  "/audio",        &Server::handleAudio},
+        {"GET",  "/stream",       &Server::handleStream},
+        {"GET",  "/stations",     &Server::handleStations},
+        {"GET",  "/hls/live.m3u8", &Server::handleHlsPlaylist},
+        {"GET",  "/hls/init.mp4", &Server::handleHlsInit},
+    };
+    static constexpr RouteTable<RouteHandler, std::size(list)> table{list};
+    static_assert(table.perfect(), "no collision-free seed for the route table");
+};
+
+// /stations/<name>/reszta -> stacja <name>, path = /reszta; bez prefiksu stacja 0.
+// nullptr = nieznana stacja.
+Station* Server::resolveStation(std::string_view& path) {
+    constexpr std::string_view prefix = "/stations/";
+    if (path.substr(0, prefix.size()) != prefix)
+        return stations.front().get();
+
+    std::string_view rest = path.substr(prefix.size());
+    size_t slash = rest.find('/');
+    std::string_view name = rest.substr(0, slash);
+    for (auto& station : stations) {
+        if (station->name == name) {
+            path = slash == std::string_view::npos ? std::string_view() : rest.substr(slash);
+            return station.get();
+        }
+    }
+    return nullptr;
+}
+
+void Server::handleHttpRequest(HttpConnection& client, const HttpRequest& req) {
+    std::string_view path = req.path;
+    Station* station = resolveStation(path);
+    if (!station) {
+        sendHttpResponse(client, "Not Found", "text/plain", 404);
+        return;
+    }
+    if (path.empty()) {
+        // /stations/<name> -> /stations/<name>/, zeby wzgledne adresy UI trafialy do stacji
+        HttpResponse& res = client.response;
+        res.start(301);
+        res.header("Location", std::string(req.path) + "/");
+        res.header("Content-Length", static_cast<uint64_t>(0));
+        res.endHeaders(client.keep_alive, KEEPALIVE_IDLE_S, KEEPALIVE_MAX_REQUESTS - client.requests);
+        sendPrepared(client, {});
+        return;
+    }
+
+    const Route<RouteHandler>* route = Routes::table.find(req.method, path);
+    constexpr std::string_view hls_prefix = "/hls/";
+    if (!route && req.method == "GET" && path.substr(0, hls_prefix.size()) == hls_prefix) {
+        handleHlsSegment(client, req, path.substr(hls_prefix.size()), *station);
+        return;
+    }
+    if (!route) {
+        if (Routes::table.hasPath(path))
+            sendHttpResponse(client, "Method Not Allowed", "text/plain", 405);
+        else
+            sendHttpResponse(client, "Not Found", "text/plain", 404);
+        return;
+    }
+
+    const QueryParams query(req.query);
+    (this->*route->handler)(client, req, query, *station);
+}
+
+void Server::handleIndex(HttpConnection& client, const HttpRequest& req, const QueryParams&, Station&) {
+    auto asset = static_assets.get("index.html");
+    if (!asset) {
+        sendHttpResponse(client, "index not found", "text/plain", 404);
+        return;
+    }
+    sendStaticAsset(client, req, *asset);
+}
+
+void Server::handleLibrary(HttpConnection& client, const HttpRequest&, const QueryParams&, Station&) {
+    auto audioFiles = library.list("audio");
+    auto uploadFiles = library.list("uploads");
+
+    JsonWriter json(client.response.beginBody());
+    json.beginObject().key("audio").beginArray();
+    for (const auto& f : audioFiles) json.value(f);
+    json.endArray().key("uploads").beginArray();
+    for (const auto& f : uploadFiles) json.value(f);
+    json.endArray().endObject();
+    sendJson(client);
+}
+
+void Server::handleProgress(HttpConnection& client, const HttpRequest&, const QueryParams&, Station& station) {
+    JsonWriter json(client.response.beginBody());
+    progressJson(json, station);
+    sendJson(client);
+}
+
+void Server::handleStats(HttpConnection& client, const HttpRequest&, const QueryParams&, Station&) {
+    JsonWriter json(client.response.beginBody());
+    statsJson(json);
+    sendJson(client);
+}
+
+void Server::handleEvents(HttpConnection& client, const HttpRequest&, const QueryParams&, Station& station) {
+    subscribeEvents(client, station);
+}
+
+void Server::handleSkip(HttpConnection& client, const HttpRequest& req, const QueryParams&, Station& station) {
+    if (req.method == "POST")
+        station.skip_requested = true;
+    sendHttpResponse(client, "{\"status\":\"skip\"}", "application/json", 200);
+}
+
+void Server::handleQueueList(HttpConnection& client, const HttpRequest&, const QueryParams&, Station& station) {
+    JsonWriter json(client.response.beginBody());
+    queueJson(json, station);
+    sendJson(client);
+}
+
+void Server::handleQueueAdd(HttpConnection& client, const HttpRequest& req, const QueryParams&, Station& station) {
+    std::string_view line = trimBody(req.body);
+    std::string fname(line.substr(0, line.find_first_of("\r\n")));
+    if (fname.empty()) {
+        sendHttpResponse(client, "{\"error\":\"filename required\"}", "application/json", 400);
+        return;
+    }
+
+    struct stat st{};
+    if (stat(fname.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+        sendHttpResponse(client, "{\"error\":\"file not found on server\"}", "application/json", 400);
+        return;
+    }
+
+    int id = enqueueTrack(station, fname);
+    JsonWriter(client.response.beginBody()).beginObject().field("enqueued", id).field("file", fname).endObject();
+    sendJson(client);
+}
+
+void Server::handleQueueMove(HttpConnection& client, const HttpRequest& req, const QueryParams&, Station& station) {
+    const QueryParams form(trimBody(req.body));
+    long from = form.getInt("from");
+    long to = form.getInt("to");
+    if (from < 0 || to < 0) {
+        sendHttpResponse(client, "{\"error\":\"missing from/to parameters\"}", "application/json", 400);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(station.playlist_mutex);
+        std::deque<Track>& playlist = station.playlist;
+        if (static_cast<size_t>(from) >= playlist.size() || static_cast<size_t>(to) >= playlist.size()) {
+            sendHttpResponse(client, "{\"error\":\"index out of range\"}", "application/json", 400);
+            return;
+        }
+
+        auto it = playlist.begin();
+        std::advance(it, from);
+        Track track = *it;
+        playlist.erase(it);
+
+        it = playlist.begin();
+        std::advance(it, to);
+        playlist.insert(it, track);
+    }
+    station.queue_version.fetch_add(1, std::memory_order_release);
+
+    JsonWriter(client.response.beginBody())
+        .beginObject()
+        .field("status", "moved")
+        .field("from", static_cast<int64_t>(from))
+        .field("to", static_cast<int64_t>(to))
+        .endObject();
+    sendJson(client);
+}
+
+void Server::handleQueueRemove(HttpConnection& client, const HttpRequest& req, const QueryParams&, Station& station) {
+    const QueryParams form(trimBody(req.body));
+    long index = form.getInt("index");
+    if (index < 0) {
+        sendHttpResponse(client, "{\"error\":\"missing index parameter\"}", "application/json", 400);
+        return;
+    }
 
     {
-        std::lock_guard<std::mutex> lock(playback_mutex);
-        if (current_wav.data.empty()) {
-            sendHttpResponse(client, "No audio loaded", "text/plain", 404);
+        std::lock_guard<std::mutex> lock(station.playlist_mutex);
+        std::deque<Track>& playlist = station.playlist;
+        if (static_cast<size_t>(index) >= playlist.size()) {
+            sendHttpResponse(client, "{\"error\":\"index out of range\"}", "application/json", 400);
             return;
         }
-        data = current_wav.data;
-        sampleRate = current_wav.sampleRate;
-        channels = current_wav.channels;
-        bits = current_wav.bitsPerSample;
-        start_pos = current_position.load(std::memory_order_acquire);
+
+        auto it = playlist.begin();
+        std::advance(it, index);
+        playlist.erase(it);
     }
+    station.queue_version.fetch_add(1, std::memory_order_release);
+
+    JsonWriter(client.response.beginBody())
+        .beginObject()
+        .field("status", "removed")
+        .field("index", static_cast<int64_t>(index))
+        .endObject();
+    sendJson(client);
+}
 
-    auto write_u32 = [](uint8_t* p, uint32_t v) {
-        p[0] = v & 0xFF; p[1] = (v >> 8) & 0xFF; p[2] = (v >> 16) & 0xFF; p[3] = (v >> 24) & 0xFF; };
-    auto write_u16 = [](uint8_t* p, uint16_t v) {
-        p[0] = v & 0xFF; p[1] = (v >> 8) & 0xFF; };
+void Server::handleAudio(HttpConnection& client, const HttpRequest& req, const QueryParams& query, Station& station) {
+    streamHttpAudio(client, req, query, station, false);
+}
 
-    uint32_t data_size = static_cast<uint32_t>(data.size());
-    uint32_t byte_rate = static_cast<uint32_t>(sampleRate * channels * (bits / 8));
-    uint16_t block_align = static_cast<uint16_t>(channels * (bits / 8));
-
-    std::vector<uint8_t> header(44, 0);
-    std::memcpy(&header[0], "RIFF", 4);
-    write_u32(&header[4], 36 + data_size);
-    std::memcpy(&header[8], "WAVE", 4);
-    std::memcpy(&header[12], "fmt ", 4);
-    write_u32(&header[16], 16);
-    write_u16(&header[20], 1);
-    write_u16(&header[22], static_cast<uint16_t>(channels));
-    write_u32(&header[24], static_cast<uint32_t>(sampleRate));
-    write_u32(&header[28], byte_rate);
-    write_u16(&header[32], block_align);
-    write_u16(&header[34], static_cast<uint16_t>(bits));
-    std::memcpy(&header[36], "data", 4);
-    write_u32(&header[40], data_size);
-
-    auto send_chunk = [&](const uint8_t* ptr, size_t len) -> bool {
-        if (len == 0) return true;
-        char size_line[32];
-        // rozmiar chunku \r\n
-        int m = std::snprintf(size_line, sizeof(size_line), "%zx\r\n", len);
-        if (m <= 0) return false;
-        // zapisanie rozmiaru chunku
-        if (!send_all(client, reinterpret_cast<const uint8_t*>(size_line), static_cast<size_t>(m))) return false;
-        // zapisanie danych do chunku
-        if (!send_all(client, ptr, len)) return false;
-        // koniec chunku \r\n
-        return send_all(client, reinterpret_cast<const uint8_t*>("\r\n"), 2);
-    };
+void Server::handleStream(HttpConnection& client, const HttpRequest& req, const QueryParams& query, Station& station) {
+    streamHttpAudio(client, req, query, station, true);
+}
 
-    std::string http_header =
-        "HTTP/1.1 200 OK\r\n"
-        "Content-Type: audio/wav\r\n"
-        "Transfer-Encoding: chunked\r\n"
-        "Connection: close\r\n\r\n";
+// Playlista live: skladana raz przy kazdym nowym segmencie, tu tylko wysylana.
+// Posrednik moze ja trzymac najwyzej pol segmentu.
+void Server::handleHlsPlaylist(HttpConnection& client, const HttpRequest&, const QueryParams&, Station& station) {
+    auto playlist = station.hls->playlist();
+    HttpResponse& res = client.response;
+    if (!playlist) {
+        res.start(503);
+        res.header("Retry-After", static_cast<uint64_t>(station.hls->targetDuration()));
+        res.header("Content-Type", "text/plain");
+        res.header("Content-Length", static_cast<uint64_t>(0));
+        res.endHeaders(client.keep_alive, KEEPALIVE_IDLE_S, KEEPALIVE_MAX_REQUESTS - client.requests);
+        sendPrepared(client, {});
+        return;
+    }
+    res.start(200);
+    res.header("Content-Type", "application/vnd.apple.mpegurl");
+    res.header("Cache-Control", "public, max-age=" + std::to_string(std::max(1u, station.hls->targetDuration() / 2)));
+    res.header("Access-Control-Allow-Origin", "*");
+    res.header("Content-Length", playlist->size());
+    res.endHeaders(client.keep_alive, KEEPALIVE_IDLE_S, KEEPALIVE_MAX_REQUESTS - client.requests);
+    sendPrepared(client, *playlist);
+}
 
-    if (!send_all(client, reinterpret_cast<const uint8_t*>(http_header.data()), http_header.size())) {
-        close(client);
+// Segment inicjujacy fMP4 (EXT-X-MAP): staly, ale ten sam adres po zmianie
+// formatu strumienia ma inna tresc - stad walidacja po ETag zamiast max-age.
+void Server::handleHlsInit(HttpConnection& client, const HttpRequest& req, const QueryParams&, Station& station) {
+    const std::string& body = station.hls->initSegment();
+    std::string_view inm = req.header("If-None-Match");
+    bool not_modified = !inm.empty() && etagMatches(inm, station.hls->initEtag());
+
+    HttpResponse& res = client.response;
+    res.start(not_modified ? 304 : 200);
+    res.header("ETag", station.hls->initEtag());
+    res.header("Cache-Control", "no-cache");
+    res.header("Access-Control-Allow-Origin", "*");
+    if (!not_modified) {
+        res.header("Content-Type", "audio/mp4");
+        res.header("Content-Length", body.size());
+    }
+    res.endHeaders(client.keep_alive, KEEPALIVE_IDLE_S, KEEPALIVE_MAX_REQUESTS - client.requests);
+    sendPrepared(client, not_modified ? std::string_view() : std::string_view(body));
+}
+
+// Segment z pamieci bez kopiowania: ta sama tresc dla kazdego klienta, 304 gdy klient ja ma.
+void Server::handleHlsSegment(HttpConnection& client, const HttpRequest& req, std::string_view name, Station& station) {
+    constexpr std::string_view suffix = ".m4s";
+    std::shared_ptr<const HlsSegment> segment;
+    if (name.size() > suffix.size() && name.size() <= suffix.size() + 20 &&
+        name.substr(name.size() - suffix.size()) == suffix) {
+        std::string_view digits = name.substr(0, name.size() - suffix.size());
+        if (std::all_of(digits.begin(), digits.end(), [](char c) { return c >= '0' && c <= '9'; }))
+            segment = station.hls->segment(std::strtoull(std::string(digits).c_str(), nullptr, 10));
+    }
+    if (!segment) {
+        sendHttpResponse(client, "Not Found", "text/plain", 404);
         return;
-    } // http header
+    }
 
-    if (!send_chunk(header.data(), header.size())) { close(client); return; }
-    // wav header
+    std::string_view inm = req.header("If-None-Match");
+    bool not_modified = !inm.empty() && etagMatches(inm, segment->etag);
+
+    HttpResponse& res = client.response;
+    res.start(not_modified ? 304 : 200);
+    res.header("ETag", segment->etag);
+    res.header("Cache-Control", "public, max-age=" + std::to_string(HLS_SEGMENT_MAX_AGE_S) + ", immutable");
+    res.header("Access-Control-Allow-Origin", "*");
+    if (!not_modified) {
+        res.header("Content-Type", "audio/mp4");
+        res.header("Content-Length", segment->body.size());
+    }
+    res.endHeaders(client.keep_alive, KEEPALIVE_IDLE_S, KEEPALIVE_MAX_REQUESTS - client.requests);
+    if (not_modified)
+        sendPrepared(client, {});
+    else
+        sendPrepared(client, segment->body, segment);
+}
+
+void Server::handleStations(HttpConnection& client, const HttpRequest&, const QueryParams&, Station&) {
+    JsonWriter json(client.response.beginBody());
+    json.beginObject().key("stations").beginArray();
+    for (auto& station : stations) {
+        std::string track;
+        {
+            std::lock_guard<std::mutex> lock(station->playback_mutex);
+            track = station->current_track_name;
+        }
+        json.beginObject()
+            .field("name", station->name)
+            .field("path", "/stations/" + station->name + "/")
+            .field("track", track)
+            .endObject();
+    }
+    json.endArray().endObject();
+    sendJson(client);
+}
 
-    size_t sent = start_pos;
-    const size_t track_size = data.size();
+void Server::queueJson(JsonWriter& json, Station& station) {
+    json.beginObject().key("queue").beginArray();
+    {
+        std::lock_guard<std::mutex> lock(station.playlist_mutex);
+        const std::deque<Track>& playlist = station.playlist;
+        for (size_t i = 0; i < playlist.size(); ++i) {
+            json.beginObject()
+                .field("id", playlist[i].id)
+                .field("index", i)
+                .field("file", playlist[i].filename)
+                .endObject();
+        }
+    }
+    json.endArray().endObject();
+}
 
-    while (running) {
-        size_t available = 0;
-        bool track_done = false;
-        bool do_skip = false;
+void Server::progressJson(JsonWriter& json, Station& station) {
+    double duration = 0.0;
+    double elapsed = 0.0;
+    double position = 0.0;
+    std::string filename;
 
+    {
+        std::lock_guard<std::mutex> lock(station.playback_mutex);
+        const WavFile& wav = *station.wav;
+        if (wav.sampleRate > 0 && wav.channels > 0 && wav.bitsPerSample > 0) {
+            double bytesPerSecond = wav.sampleRate * wav.channels * (wav.bitsPerSample / 8.0);
+            duration = wav.data.size() / bytesPerSecond;
+            size_t pos = station.current_position.load(std::memory_order_acquire);
+            elapsed = pos / bytesPerSecond;
+            if (duration > 0.0)
+                position = elapsed / duration;
+            filename = station.current_track_name;
+        }
+    }
+
+    json.beginObject()
+        .field("position", position)
+        .field("elapsed", elapsed)
+        .field("duration", duration)
+        .field("filename", filename)
+        .endObject();
+}
+
+void Server::statsJson(JsonWriter& json) {
+    size_t listener_count = 0;
+    size_t subscriber_count = 0;
+    {
+        std::lock_guard<std::mutex> lock(listeners_mutex);
+        listener_count = listeners.size();
+    }
+    {
+        std::lock_guard<std::mutex> lock(subscribers_mutex);
+        subscriber_count = subscribers.size();
+    }
+    auto count = [](const std::atomic<uint64_t>& c) { return c.load(std::memory_order_relaxed); };
+    const char* sendBackend = "epoll";
+#if AUDIO_IO_URING
+    if (uring) sendBackend = "io_uring";
+#endif
+
+    json.beginObject()
+        .field("listeners", listener_count)
+        .field("subscribers", subscriber_count)
+        .field("reactors", shards.size());
+    // przyjete polaczenia na reaktor - rozklad SO_REUSEPORT
+    json.key("accepted").beginArray();
+    for (auto& shard : shards)
+        json.value(count(shard->accepted));
+    json.endArray();
+    // sluchacze na stacje; zegary stacji bez lokalnego wyjscia sa rozlozone na rdzenie
+    json.key("stations").beginArray();
+    for (auto& station : stations) {
+        size_t station_listeners = 0;
         {
-            std::unique_lock<std::mutex> lock(playback_mutex);
-            playback_cv.wait_for(lock, std::chrono::milliseconds(200), [&]{
-                size_t pos = current_position.load(std::memory_order_acquire);
-                return !running || skip_requested || pos > sent || pos >= track_size;
-            }); // budzi sie na playback_cv lub co 200ms
-
-            size_t pos = current_position.load(std::memory_order_acquire);
-            available = (pos > sent) ? (pos - sent) : 0;
-            track_done = pos >= track_size;
-            do_skip = skip_requested;
-        }
-
-        if (available) {
-            size_t to_send = available;
-            if (sent + to_send > track_size) to_send = track_size - sent;
-            if (!send_chunk(data.data() + sent, to_send)) {
-                close(client);
-                return;
-            }
-            sent += to_send;
+            std::lock_guard<std::mutex> lock(listeners_mutex);
+            for (auto& entry : listeners)
+                if (entry.second->station == station.get()) ++station_listeners;
         }
+        json.beginObject()
+            .field("name", station->name)
+            .field("listeners", station_listeners)
+            .field("clock", station->local_output ? "portaudio" : "software")
+            .field("hls_segments", station->hls->segmentCount())
+            .endObject();
+    }
+    TrackCache::Stats cache = track_cache.stats();
+    json.endArray()
+        .key("track_cache").beginObject()
+            .field("entries", cache.entries)
+            .field("bytes", cache.bytes)
+            .field("hits", cache.hits)
+            .field("misses", cache.misses)
+        .endObject()
+        .field("lag_policy", lagPolicyName(lag_policy))
+        .field("max_lag_ms", LISTENER_MAX_LAG_MS)
+        .field("send_backend", sendBackend)
+        .field("send_syscalls", count(send_syscalls))
+        .field("pcm_kernel", pcmKernelName(pcmKernel()))
+        .key("lag").beginObject()
+            .field("skipped_to_live", count(lag_counters.skipped_to_live))
+            .field("dropped_oldest", count(lag_counters.dropped_oldest))
+            .field("disconnected", count(lag_counters.disconnected))
+            .field("stalled", count(lag_counters.stalled))
+            .field("zerocopy_expired", count(lag_counters.zerocopy_expired))
+        .endObject()
+        .endObject();
+}
 
-        if (track_done || do_skip || !running)
-            break;
+// write_json(JsonWriter&) dopisuje dane zdarzenia prosto do out
+template <typename WriteJson>
+static void appendSseEvent(std::string& out, const char* name, WriteJson&& write_json) {
+    out += "event: ";
+    out += name;
+    out += "\ndata: ";
+    JsonWriter json(out);
+    write_json(json);
+    out += "\n\n";
+}
+
+void Server::subscribeEvents(HttpConnection& conn, Station& station) {
+    auto sub = std::make_shared<EventSubscriber>();
+    sub->fd = conn.fd;
+    sub->station = &station;
+    sub->epoll_fd = conn.epoll_fd;
+
+    // bez Content-Length - strumien konczy sie zamknieciem polaczenia
+    sub->out =
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: text/event-stream\r\n"
+        "Cache-Control: no-cache\r\n"
+        "Connection: close\r\n\r\n"
+        "retry: 2000\n\n";
+    appendSseEvent(sub->out, "queue", [this, &station](JsonWriter& json) { queueJson(json, station); });
+    appendSseEvent(sub->out, "progress", [this, &station](JsonWriter& json) { progressJson(json, station); });
+
+    conn.detached = true;
+    {
+        std::lock_guard<std::mutex> lock(connections_mutex);
+        connections.erase(conn.fd);
     }
 
-    send_all(client, reinterpret_cast<const uint8_t*>("0\r\n\r\n"), 5);
-    close(client);
+    sub->busy = true;
+    {
+        std::lock_guard<std::mutex> lock(subscribers_mutex);
+        subscribers[sub->fd] = sub;
+    }
+    flushSubscriber(sub);
 }
 
+// Wywolywane z watku reaktora co tick: zdarzenie serializowane jest raz na
+// stacje i dopisywane do bufora kazdego subskrybenta tej stacji.
+void Server::publishEvents() {
+    {
+        std::lock_guard<std::mutex> lock(subscribers_mutex);
+        if (subscribers.empty()) return;
+    }
 
-inline float pcm24ToFloat(const uint8_t* p) {
-    int32_t sample =
-        (p[0]) |
-        (p[1] << 8) |
-        (p[2] << 16);
+    auto now = std::chrono::steady_clock::now();
+    for (auto& station : stations)
+        publishStationEvents(*station, now);
+}
 
-    if (sample & 0x800000)
-        sample |= ~0xFFFFFF;
+void Server::publishStationEvents(Station& station, std::chrono::steady_clock::time_point now) {
+    std::string events;
 
-    return sample / 8388608.0f;
+    unsigned queue_now = station.queue_version.load(std::memory_order_acquire);
+    if (queue_now != station.published_queue_version) {
+        station.published_queue_version = queue_now;
+        appendSseEvent(events, "queue", [this, &station](JsonWriter& json) { queueJson(json, station); });
+    }
+
+    unsigned generation = station.track_generation.load(std::memory_order_acquire);
+    bool track_changed = generation != station.published_generation;
+    size_t position = station.current_position.load(std::memory_order_acquire);
+    if (track_changed) {
+        station.published_generation = generation;
+        std::string name;
+        {
+            std::lock_guard<std::mutex> lock(station.playback_mutex);
+            name = station.current_track_name;
+        }
+        appendSseEvent(events, "track", [&name](JsonWriter& json) {
+            json.beginObject().field("filename", name).endObject();
+        });
+    }
+    if (track_changed ||
+        (position != station.published_position &&
+         now - station.last_progress_event >= std::chrono::milliseconds(PROGRESS_EVENT_MS))) {
+        station.published_position = position;
+        station.last_progress_event = now;
+        appendSseEvent(events, "progress", [this, &station](JsonWriter& json) { progressJson(json, station); });
+    }
+
+    if (events.empty()) {
+        if (now - station.last_event_sent < std::chrono::seconds(KEEPALIVE_IDLE_S)) return;
+        events = ": ping\n\n";
+    }
+    station.last_event_sent = now;
+
+    std::vector<std::shared_ptr<EventSubscriber>> ready;
+    std::vector<int> lagging;
+    {
+        std::lock_guard<std::mutex> lock(subscribers_mutex);
+        for (auto& entry : subscribers) {
+            auto& sub = entry.second;
+            if (sub->station != &station) continue;
+            {
+                std::lock_guard<std::mutex> out_lock(sub->out_mutex);
+                if (sub->out.size() - sub->out_offset > MAX_EVENT_BACKLOG) {
+                    lagging.push_back(entry.first);
+                    continue;
+                }
+                sub->out += events;
+            }
+            if (!sub->busy.exchange(true))
+                ready.push_back(sub);
+        }
+    }
+
+    for (int fd : lagging)
+        dropSubscriber(fd);
+    for (auto& sub : ready)
+        control_workers.submit([this, sub]{ flushSubscriber(sub); });
+}
+
+void Server::flushSubscriber(const std::shared_ptr<EventSubscriber>& sub) {
+    std::unique_lock<std::mutex> lock(sub->out_mutex);
+    while (sub->out_offset < sub->out.size()) {
+        ssize_t s = send(sub->fd, sub->out.data() + sub->out_offset, sub->out.size() - sub->out_offset, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (s > 0) {
+            sub->out_offset += static_cast<size_t>(s);
+            continue;
+        }
+        if (s < 0 && errno == EINTR) continue;
+        if (s < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            epoll_event ev{};
+            ev.events = EPOLLOUT | EPOLLRDHUP | EPOLLONESHOT;
+            ev.data.fd = sub->fd;
+            if (epoll_ctl(sub->epoll_fd, EPOLL_CTL_MOD, sub->fd, &ev) == 0)
+                return;
+        }
+        lock.unlock();
+        dropSubscriber(sub->fd);
+        return;
+    }
+    sub->out.clear();
+    sub->out_offset = 0;
+    sub->busy = false;
+
+    // w spoczynku czekamy tylko na zamkniecie polaczenia przez klienta
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+    ev.data.fd = sub->fd;
+    epoll_ctl(sub->epoll_fd, EPOLL_CTL_MOD, sub->fd, &ev);
 }
 
-WavFile Server::loadWav(const std::string& filename) {
-    std::ifstream f(filename, std::ios::binary);
-    if (!f)
-        throw std::runtime_error("Cannot open WAV file: " + filename);
+void Server::dropSubscriber(int fd) {
+    {
+        std::lock_guard<std::mutex> lock(subscribers_mutex);
+        if (subscribers.erase(fd) == 0) return;
+    }
+    close(fd);
+}
 
-    char chunkId[4];
-    uint32_t chunkSize;
+int Server::enqueueTrack(Station& station, const std::string& filename) {
+    std::lock_guard<std::mutex> lock(station.playlist_mutex);
+    int id = next_track_id++;
+    station.playlist.push_back({id, filename});
+    station.queue_version.fetch_add(1, std::memory_order_release);
+    return id;
+}
 
-    f.read(chunkId, 4);
-    if (std::strncmp(chunkId, "RIFF", 4) != 0)
-        throw std::runtime_error("Not a RIFF file");
+// rozmiar chunku \r\n
+static void appendChunkHeader(std::string& out, size_t len) {
+    char size_line[32];
+    int m = std::snprintf(size_line, sizeof(size_line), "%zx\r\n", len);
+    out.append(size_line, static_cast<size_t>(m));
+}
 
-    f.read(reinterpret_cast<char*>(&chunkSize), 4);
+// rozmiar chunku \r\n dane \r\n
+static void appendChunk(std::string& out, const uint8_t* data, size_t len) {
+    if (len == 0) return;
+    appendChunkHeader(out, len);
+    out.append(reinterpret_cast<const char*>(data), len);
+    out += "\r\n";
+}
 
-    f.read(chunkId, 4);
-    if (std::strncmp(chunkId, "WAVE", 4) != 0)
-        throw std::runtime_error("Not a WAVE file");
+static_assert(ICY_METAINT > WAV_HEADER_BYTES, "ICY_METAINT must leave room for the WAV header");
 
-    WavFile wav;
+// StreamTitle z nazwy pliku: bez katalogu i rozszerzenia. ICY nie ma escapowania,
+// wiec apostrofy i znaki sterujace wypadaja; blok ma najwyzej 255 * 16 bajtow.
+static std::string icyTitle(const std::string& filename) {
+    std::string_view name = filename;
+    auto slash = name.find_last_of('/');
+    if (slash != std::string_view::npos) name.remove_prefix(slash + 1);
+    auto dot = name.find_last_of('.');
+    if (dot != std::string_view::npos && dot > 0) name = name.substr(0, dot);
 
-    while (f) {
-        f.read(chunkId, 4);
-        f.read(reinterpret_cast<char*>(&chunkSize), 4);
+    std::string title;
+    for (char c : name) {
+        if (c == '\'' || static_cast<unsigned char>(c) < 0x20) continue;
+        title += c;
+    }
+    title.resize(std::min<size_t>(title.size(), 255 * 16 - 16));
+    return title;
+}
 
-        if (std::strncmp(chunkId, "fmt ", 4) == 0) {
-            uint16_t audioFormat;
-            f.read(reinterpret_cast<char*>(&audioFormat), 2);
-            f.read(reinterpret_cast<char*>(&wav.channels), 2);
-            f.read(reinterpret_cast<char*>(&wav.sampleRate), 4);
-            f.ignore(6);
-            f.read(reinterpret_cast<char*>(&wav.bitsPerSample), 2);
+// Blok metadanych ICY: bajt dlugosci (w 16-bajtowych jednostkach) i tekst
+// dopelniony zerami; bez tytulu sam bajt 0.
+static void appendIcyBlock(std::string& out, std::string_view title) {
+    if (title.empty()) {
+        out += '\0';
+        return;
+    }
+    size_t len = title.size() + 15; // StreamTitle='';
+    size_t blocks = (len + 15) / 16;
+    out += static_cast<char>(blocks);
+    size_t start = out.size();
+    out += "StreamTitle='";
+    out += title;
+    out += "';";
+    out.resize(start + blocks * 16, '\0');
+}
 
-            if (audioFormat != 1)
-                throw std::runtime_error("Only PCM WAV supported");
+// /audio: domyslnie od biezacej pozycji nadawania. ?t=sekundy i Range (bajty
+// pliku WAV utworu) ustawiaja kursor w tym samym ring - bez osobnego strumienia.
+// Dostepne jest tylko to, co jeszcze jest w oknie ring; reszta jest przycinana
+// (?t=) albo Range jest ignorowany i idzie zwykla odpowiedz 200 "na zywo".
+// continuous (/stream): jeden nieskonczony WAV w stream_format przez wszystkie
+// utwory; ?t= liczy sie od poczatku biezacego utworu, Range nie jest obslugiwany.
+void Server::streamHttpAudio(HttpConnection& conn, const HttpRequest& req, const QueryParams& query, Station& station,
+                             bool continuous) {
+    const int client = conn.fd;
+    auto listener = std::make_shared<AudioListener>();
+    listener->fd = client;
+    listener->station = &station;
+    listener->epoll_fd = conn.epoll_fd;
+    int sampleRate = 0;
+    int channels = 0;
+    int bits = 0;
+    uint64_t head = 0;
+    // poczatek biezacego utworu w ring sluchacza (dla ?t=)
+    uint64_t seek_base = 0;
+
+    if (continuous) {
+        // dolaczyc mozna tez w ciszy przed pierwszym utworem - dane pojda, gdy zacznie grac
+        std::lock_guard<std::mutex> lock(station.playback_mutex);
+        sampleRate = stream_format.sample_rate;
+        channels = stream_format.channels;
+        bits = stream_format.bits;
+        listener->ring = station.stream_ring;
+        head = station.stream_ring->head();
+        listener->cursor = head;
+        // ring zawiera same pelne ramki od zera, wiec to jest podstawa wyrownania
+        listener->track_start = 0;
+        // konwerter nalezy do zegara stacji, wiec rozmiar liczony z samych formatow
+        const WavFile& wav = *station.wav;
+        listener->track_size = static_cast<size_t>(PcmConverter::outputBytes(
+            {wav.sampleRate, wav.channels, wav.bitsPerSample}, stream_format, wav.data.size()));
+        listener->frame_size = stream_format.frameSize();
+        listener->continuous = true;
+        listener->generation = station.track_generation.load(std::memory_order_acquire);
+        listener->icy_title = icyTitle(station.current_track_name);
+        seek_base = station.stream_track_start.load(std::memory_order_acquire);
+    } else {
+        std::lock_guard<std::mutex> lock(station.playback_mutex);
+        const WavFile& wav = *station.wav;
+        if (wav.data.empty()) {
+            sendHttpResponse(conn, "No audio loaded", "text/plain", 404);
+            return;
+        }
+        sampleRate = wav.sampleRate;
+        channels = wav.channels;
+        bits = wav.bitsPerSample;
+        listener->ring = station.broadcast;
+        head = station.broadcast->head();
+        listener->cursor = head;
+        listener->track_start = station.track_start_offset.load(std::memory_order_acquire);
+        listener->track_size = wav.data.size();
+        listener->frame_size = static_cast<size_t>(channels * (bits / 8));
+        listener->generation = station.track_generation.load(std::memory_order_acquire);
+        listener->icy_title = icyTitle(station.current_track_name);
+        seek_base = listener->track_start;
+    }
+
+    // dlugosc nieznana: 0xFFFFFFFF to przyjete oznaczenie strumienia bez konca
+    uint32_t data_size = continuous ? 0xFFFFFFFFu : static_cast<uint32_t>(listener->track_size);
+    uint32_t byte_rate = static_cast<uint32_t>(sampleRate * channels * (bits / 8));
 
-            if (wav.bitsPerSample != 24 && wav.bitsPerSample != 16)
-                throw std::runtime_error("Only 16-bit or 24-bit WAV supported");
+    // limit zaleglosci w pelnych ramkach; wiekszy niz okno ring i tak nie ma sensu
+    size_t max_lag = static_cast<size_t>(uint64_t(byte_rate) * LISTENER_MAX_LAG_MS / 1000);
+    max_lag = std::min(max_lag, listener->ring->window());
+    listener->max_lag = std::max(max_lag - max_lag % listener->frame_size, listener->frame_size);
+
+    // najwczesniejsza pozycja, od ktorej mozna zaczac: opoznienie + dopuszczalna
+    // zaleglosc musza zmiescic sie w oknie ring, inaczej dane zostana nadpisane
+    const uint64_t track_start = listener->track_start;
+    const size_t frame = listener->frame_size;
+    const uint64_t max_delay = listener->ring->window() - listener->max_lag;
+    uint64_t earliest = std::max(track_start, head > max_delay ? head - max_delay : 0);
+    earliest = std::min(earliest + (frame - (earliest - track_start) % frame) % frame, head);
+
+    const uint64_t total = WAV_HEADER_BYTES + listener->track_size;
+    uint64_t first = 0, last = 0;
+    RangeResult range = continuous ? RangeResult::None : parseByteRange(req.header("Range"), total, first, last);
+    if (range == RangeResult::Unsatisfiable) {
+        HttpResponse& res = conn.response;
+        res.start(416);
+        res.header("Content-Range", "bytes */" + std::to_string(total));
+        res.header("Content-Length", static_cast<uint64_t>(0));
+        res.endHeaders(conn.keep_alive, KEEPALIVE_IDLE_S, KEEPALIVE_MAX_REQUESTS - conn.requests);
+        sendPrepared(conn, {});
+        return;
+    }
 
-            f.ignore(chunkSize - 16);
+    // bytes=0- wysyla kazdy element <audio> na starcie - to zwykle dolaczenie na zywo
+    size_t header_from = 0;
+    size_t header_to = WAV_HEADER_BYTES;
+    bool partial = false;
+    if (range == RangeResult::Satisfiable && !(first == 0 && last == total - 1)) {
+        uint64_t from = track_start + (first > WAV_HEADER_BYTES ? first - WAV_HEADER_BYTES : 0);
+        if (last < WAV_HEADER_BYTES) {
+            // sam naglowek - probki nie sa potrzebne
+            partial = true;
+            listener->cursor = head;
+            listener->track_size = 0;
+        } else if (from >= earliest && from <= head) {
+            partial = true;
+            listener->cursor = from;
+            listener->track_size = static_cast<size_t>(last + 1 - WAV_HEADER_BYTES);
         }
-        else if (std::strncmp(chunkId, "data", 4) == 0) {
-            wav.data.resize(chunkSize);
-            f.read(reinterpret_cast<char*>(wav.data.data()), chunkSize);
-            break;
+        if (partial) {
+            header_from = static_cast<size_t>(std::min(first, WAV_HEADER_BYTES));
+            header_to = static_cast<size_t>(std::min(last + 1, WAV_HEADER_BYTES));
+            listener->exact = true;
         }
-        else {
-            f.ignore(chunkSize);
+    } else if (query.has("t")) {
+        double t = query.getDouble("t", 0.0);
+        uint64_t rel = static_cast<uint64_t>(std::min(t * byte_rate, static_cast<double>(listener->track_size)));
+        uint64_t from = seek_base + rel - rel % frame;
+        listener->cursor = std::min(std::max(from, earliest), head);
+    }
+    listener->delay = head - std::min(head, listener->cursor);
+
+    if (!partial && !query.has("t")) {
+        // pre-roll: ostatnie LISTENER_PREROLL_MS juz nadanego dzwieku idzie od razu,
+        // zeby odtwarzacz szybciej wypelnil bufor; potem zwykle tempo nadawania.
+        // Najwyzej pol max_lag, zeby sam burst nie uruchomil polityki zaleglosci.
+        uint64_t preroll = std::min<uint64_t>(uint64_t(byte_rate) * LISTENER_PREROLL_MS / 1000, listener->max_lag / 2);
+        uint64_t from = std::max(head > preroll ? head - preroll : 0, earliest);
+        listener->cursor = track_start + (from - track_start) - (from - track_start) % frame;
+        listener->delay = 0;
+    }
+
+    uint8_t header[WAV_HEADER_BYTES];
+    writeWavHeader(header, sampleRate, channels, bits, data_size);
+
+    // ICY: tytul utworu wewnatrz strumienia; zakres bajtow musi byc dokladny, wiec nie dla 206
+    if (!partial && req.header("Icy-MetaData") == "1") {
+        listener->icy_metaint = ICY_METAINT;
+        listener->icy_remaining = ICY_METAINT - (header_to - header_from);
+        listener->icy_generation = listener->generation;
+    }
+
+    HttpResponse& res = conn.response;
+    res.start(partial ? 206 : 200);
+    res.header("Content-Type", "audio/wav");
+    res.header("Accept-Ranges", continuous ? "none" : "bytes");
+    if (partial)
+        res.header("Content-Range", "bytes " + std::to_string(first) + "-" + std::to_string(last) + "/" + std::to_string(total));
+    if (listener->icy_metaint)
+        res.header("icy-metaint", static_cast<uint64_t>(listener->icy_metaint));
+    res.header("Transfer-Encoding", "chunked");
+    res.endHeaders(false, 0, 0);
+
+    // http header + wav header, reszta idzie nieblokujaco z pumpListener
+    listener->pending.prefix = res.head();
+    appendChunk(listener->pending.prefix, header + header_from, header_to - header_from);
+
+    // gniazdo przechodzi z mapy polaczen do sluchaczy
+    conn.detached = true;
+    {
+        std::lock_guard<std::mutex> lock(connections_mutex);
+        connections.erase(client);
+    }
+    // staly bufor nadawczy zamiast autotuningu (do kilku MB na gniazdo): zaleglosc
+    // zostaje w ring, gdzie widzi ja polityka max_lag, a pamiec jadra jest ograniczona
+    int sndbuf = static_cast<int>(LISTENER_SNDBUF_BYTES);
+    setsockopt(client, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+#if AUDIO_ZEROCOPY
+    if (enableZeroCopy(client))
+        listener->mode = SendMode::ZeroCopy;
+#endif
+
+    listener->busy = true;
+    {
+        std::lock_guard<std::mutex> lock(listeners_mutex);
+        listeners[client] = listener;
+    }
+    // pierwsza tura od razu przechodzi z naglowka do pre-rollu
+    listener->behind = true;
+    pumpListener(listener);
+}
+
+void Server::pumpListeners() {
+    std::vector<std::shared_ptr<AudioListener>> ready;
+    const int64_t now = steadyMillis();
+    {
+        std::lock_guard<std::mutex> lock(listeners_mutex);
+        ready.reserve(listeners.size());
+        for (auto& entry : listeners) {
+            AudioListener& l = *entry.second;
+            // gniazdo od dawna pelne - niedokonczonego chunku nie da sie przyciac, wiec rozlaczamy;
+            // shutdown budzi reaktor (EPOLLHUP), a worker zamknie fd po bledzie wysylki
+            int64_t stalled = l.stalled_since.load(std::memory_order_relaxed);
+            if (stalled && now - stalled > CLIENT_IO_TIMEOUT_S * 1000 &&
+                l.stalled_since.exchange(0) == stalled) {
+                lag_counters.stalled.fetch_add(1, std::memory_order_relaxed);
+                shutdown(entry.first, SHUT_RDWR);
+                continue;
+            }
+            // jadro wciaz trzyma strony ring z niepotwierdzonej wysylki MSG_ZEROCOPY, a zegar
+            // zaraz je nadpisze - zrywamy polaczenie (RST przy zamknieciu zwalnia te strony)
+            uint64_t inflight = l.zerocopy.oldest();
+            if (inflight != ZeroCopyTracker::NONE &&
+                l.ring->head() - inflight > l.ring->capacity() - l.ring->capacity() / 4) {
+                lag_counters.zerocopy_expired.fetch_add(1, std::memory_order_relaxed);
+                shutdown(entry.first, SHUT_RDWR);
+                continue;
+            }
+            // zajety = juz w kolejce workera albo czeka na EPOLLOUT
+            if (!l.busy.exchange(true))
+                ready.push_back(entry.second);
         }
     }
 
-    if (wav.data.empty())
-        throw std::runtime_error("No audio data found");
+#if AUDIO_IO_URING
+    if (uring) {
+        for (auto& listener : ready)
+            queueUringSend(listener);
+        submitUringSends();
+        return;
+    }
+#endif
+    for (auto& listener : ready)
+        listener_workers.submit([this, listener]{ pumpListener(listener); });
+}
 
-    return wav;
+// Sluchacz ma do wyslania wiecej niz max_lag bajtow: przesuwa kursor wg polityki.
+// false = sluchacza trzeba rozlaczyc.
+static bool applyLagPolicy(AudioListener& l, uint64_t head, LagPolicy policy, LagCounters& counters) {
+    switch (policy) {
+        case LagPolicy::SkipToLive:
+            l.cursor = head - (head - l.track_start) % l.frame_size;
+            counters.skipped_to_live.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        case LagPolicy::DropOldest: {
+            uint64_t rel = head - l.max_lag - l.track_start + l.frame_size - 1;
+            l.cursor = l.track_start + rel - rel % l.frame_size;
+            counters.dropped_oldest.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        case LagPolicy::Disconnect:
+            counters.disconnected.fetch_add(1, std::memory_order_relaxed);
+            return false;
+    }
+    return false;
 }
 
-void Server::streamingLoop() {
-    while (running) {
-        {
-            std::lock_guard<std::mutex> lock(playlist_mutex);
-            
-            size_t pos = current_position.load(std::memory_order_acquire);
-            if (pos >= current_wav.data.size() || skip_requested) {
-                skip_requested = false;
-                stopAudioStream();
-                
-                if (!playlist.empty()) {
-                    Track track = playlist.front();
-                    playlist.pop_front();
-
-                    try {
-                        {
-                            std::lock_guard<std::mutex> pb_lock(playback_mutex);
-                            current_wav = loadWav(track.filename);
-                            current_position.store(0, std::memory_order_release);
-                            current_track_name = track.filename;
-                        }
-                        std::cout << "[SERVER] Now playing: " << track.filename << "\n";
-                        std::cout << "  Sample rate: " << current_wav.sampleRate << " Hz\n";
-                        std::cout << "  Channels:    " << current_wav.channels << "\n";
-                        std::cout << "  Bit depth:   " << current_wav.bitsPerSample << "\n";
-                        std::cout << "  UI:          http://127.0.0.1:" << (port > 0 ? port : DEFAULT_HTTP_PORT) << "/" << "\n";
-
-                        startAudioStream();
-                    }
-                    catch (const std::exception& e) {
-                        std::cerr << "[SERVER] Error loading track: " << e.what() << "\n";
-                        stopAudioStream();
-                    }
-                } else {
-                }
+void Server::pumpListener(const std::shared_ptr<AudioListener>& l) {
+    l->stalled_since.store(0, std::memory_order_relaxed);
+
+    // zaleglosc (pre-roll, nadrabianie) idzie kolejnymi chunkami od razu, az do
+    // biezacej pozycji albo pelnego gniazda - nie po jednym chunku na tick
+    do {
+        if (!prepareListener(*l)) {
+            dropListener(l->fd);
+            return;
+        }
+
+        switch (flushPending(l->fd, l->pending, *l->ring, l->mode, &l->zerocopy, &send_syscalls)) {
+            case SendStatus::Done:
+                break;
+            case SendStatus::WouldBlock:
+                waitWritable(l);
+                return;
+            case SendStatus::Error:
+                dropListener(l->fd);
+                return;
+        }
+    } while (l->behind && !l->finished);
+
+    finishListenerRound(l);
+}
+
+// Kolejna tura sluchacza: nowy chunk z ring albo koniec strumienia w pending.
+// false = sluchacza trzeba rozlaczyc.
+bool Server::prepareListener(AudioListener& l) {
+    if (!l.pending.empty() || l.finished)
+        return true;
+
+    l.pending.reset();
+    std::string& prefix = l.pending.prefix;
+
+    const BroadcastRing& ring = *l.ring;
+    // strumien ciagly nie ma konca utworu - kolejne utwory ida w tym samym ring
+    const uint64_t track_end = l.continuous ? UINT64_MAX : l.track_start + l.track_size;
+    Station& station = *l.station;
+    bool track_changed = !l.continuous && station.track_generation.load(std::memory_order_acquire) != l.generation;
+    uint64_t head = ring.head();
+    if (track_changed)
+        head = std::min(head, station.track_start_offset.load(std::memory_order_acquire));
+    head = std::min(head, track_end);
+
+    // kolejka sluchacza to zakres [cursor, live) - pilnujemy jej limitu; sluchacz
+    // przesuniety w czasie (?t=, Range) ma wlasne "na zywo", opoznione o delay
+    uint64_t live = head > l.delay ? head - l.delay : 0;
+    if (live > l.cursor && live - l.cursor > l.max_lag) {
+        if (l.exact) {
+            // przeskok zepsulby zakres bajtow - klient wznowi od swojej pozycji nowym Range
+            lag_counters.disconnected.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        if (!applyLagPolicy(l, live, lag_policy, lag_counters))
+            return false;
+    }
+
+    // sluchacz nie nadazyl i bufor zostal nadpisany - przeskok do najstarszej pelnej ramki
+    uint64_t oldest = ring.oldest();
+    if (l.cursor < oldest) {
+        if (l.exact) return false;
+        uint64_t rel = oldest - l.track_start + l.frame_size - 1;
+        l.cursor = l.track_start + rel - rel % l.frame_size;
+    }
+
+    // \r\n poprzedniego chunku laczy sie z naglowkiem nastepnego - jeden writev na tick
+    l.behind = head > l.cursor + LISTENER_CHUNK_BYTES;
+    if (l.behind) {
+        uint64_t rel = l.cursor + LISTENER_CHUNK_BYTES - l.track_start;
+        head = l.track_start + rel - rel % l.frame_size;
+    }
+    // ICY: chunk konczy sie najpozniej na granicy bloku, blok idzie na poczatku nastepnego
+    std::string meta;
+    if (l.icy_metaint && head > l.cursor) {
+        if (l.icy_remaining == 0) {
+            // strumien ciagly: nowy tytul dopiero, gdy kursor dojdzie do poczatku utworu
+            unsigned generation = station.track_generation.load(std::memory_order_acquire);
+            if (l.continuous && generation != l.icy_generation &&
+                l.cursor >= station.stream_track_start.load(std::memory_order_acquire)) {
+                std::lock_guard<std::mutex> lock(station.playback_mutex);
+                l.icy_title = icyTitle(station.current_track_name);
+                l.icy_generation = generation;
             }
+            appendIcyBlock(meta, l.icy_title);
+            l.icy_title.clear();
+            l.icy_remaining = l.icy_metaint;
+        }
+        if (head - l.cursor > l.icy_remaining) {
+            head = l.cursor + l.icy_remaining;
+            l.behind = true;
+        }
+        l.icy_remaining -= static_cast<size_t>(head - l.cursor);
+    }
+    if (head > l.cursor) {
+        if (l.chunk_open) prefix += "\r\n";
+        appendChunkHeader(prefix, meta.size() + static_cast<size_t>(head - l.cursor));
+        prefix += meta;
+        l.pending.data_begin = l.cursor;
+        l.pending.data_end = head;
+        l.cursor = head;
+        l.chunk_open = true;
+    }
+
+    // prefix idzie przed danymi z ring, wiec koniec strumienia dopiero w turze bez nowych danych
+    bool track_done = !l.continuous && (l.cursor >= track_end
+        || (track_changed && l.cursor >= head) || station.skip_requested);
+    if (l.pending.data_begin == l.pending.data_end && (!running || track_done)) {
+        if (l.chunk_open) prefix += "\r\n";
+        prefix += "0\r\n\r\n";
+        l.chunk_open = false;
+        l.finished = true;
+    }
+
+    return true;
+}
+
+// bufor gniazda pelny - reaktor wznowi sluchacza po EPOLLOUT, busy zostaje ustawione
+void Server::waitWritable(const std::shared_ptr<AudioListener>& l) {
+    epoll_event ev{};
+    ev.events = EPOLLOUT | EPOLLRDHUP | EPOLLONESHOT;
+    ev.data.fd = l->fd;
+    l->stalled_since.store(steadyMillis(), std::memory_order_relaxed);
+    if (epoll_ctl(l->epoll_fd, EPOLL_CTL_MOD, l->fd, &ev) != 0)
+        dropListener(l->fd);
+}
+
+void Server::finishListenerRound(const std::shared_ptr<AudioListener>& l) {
+    if (l->finished) {
+        dropListener(l->fd);
+        return;
+    }
+    l->busy = false;
+}
+
+#if AUDIO_IO_URING
+// Tura sluchacza jako jedno SENDMSG w io_uring; wszystkie z ticku ida jednym io_uring_enter.
+void Server::queueUringSend(const std::shared_ptr<AudioListener>& l) {
+    if (l->mode == SendMode::ZeroCopy) {
+        listener_workers.submit([this, l]{ pumpListener(l); });
+        return;
+    }
+    if (l->pending.empty()) {
+        l->stalled_since.store(0, std::memory_order_relaxed);
+        if (!prepareListener(*l)) {
+            dropListener(l->fd);
+            return;
         }
-        
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        if (l->pending.empty()) {
+            finishListenerRound(l);
+            return;
+        }
+    }
+
+    UringListenerSend& send = uring_sends[l->fd];
+    send.listener = l;
+    int cnt = pendingIov(l->pending, *l->ring, send.iov);
+    if (cnt < 0) {
+        uring_sends.erase(l->fd);
+        dropListener(l->fd);
+        return;
     }
+    send.msg = msghdr{};
+    send.msg.msg_iov = send.iov;
+    send.msg.msg_iovlen = static_cast<size_t>(cnt);
+
+    uint64_t tag = static_cast<uint64_t>(l->fd);
+    // MSG_DONTWAIT: bez niego io_uring czeka na miejsce w pelnym gniezdzie zamiast
+    // zwrocic -EAGAIN, a iovec wskazuja na ring, ktory zegar w tym czasie nadpisuje.
+    // Z nim pelne gniazdo idzie do waitWritable, jak w sciezce epoll (zaleglosc, stall).
+    const int flags = MSG_NOSIGNAL | MSG_DONTWAIT;
+    if (uring->sendmsg(l->fd, &send.msg, flags, tag))
+        return;
+    // kolejka zgloszen pelna - oddajemy ja jadru i probujemy ponownie
+    submitUringSends();
+    if (uring->sendmsg(l->fd, &send.msg, flags, tag))
+        return;
+    uring_sends.erase(l->fd);
+    listener_workers.submit([this, l]{ pumpListener(l); });
 }
 
-void Server::startAudioStream() {
-    if (audio_stream) {
-        Pa_StopStream(audio_stream);
-        Pa_CloseStream(audio_stream);
-        audio_stream = nullptr;
+void Server::submitUringSends() {
+    uint64_t before = uring->enterCalls();
+    uring->submit();
+    send_syscalls.fetch_add(uring->enterCalls() - before, std::memory_order_relaxed);
+}
+
+void Server::reapUringSends() {
+    uint64_t tag = 0;
+    int res = 0;
+    while (uring->popCompletion(tag, res)) {
+        auto it = uring_sends.find(static_cast<int>(tag));
+        if (it == uring_sends.end()) continue;
+        std::shared_ptr<AudioListener> l = std::move(it->second.listener);
+        uring_sends.erase(it);
+
+        if (res == -EAGAIN || res == -EWOULDBLOCK) {
+            waitWritable(l);
+            continue;
+        }
+        if (res <= 0) {
+            dropListener(l->fd);
+            continue;
+        }
+        consumePending(l->pending, static_cast<size_t>(res));
+        if (!l->pending.empty()) {
+            queueUringSend(l); // czesciowa wysylka - reszta w tym samym zgloszeniu zbiorczym
+            continue;
+        }
+        finishListenerRound(l);
     }
+    submitUringSends();
+}
+#endif
 
-    if (current_wav.sampleRate <= 0 || current_wav.channels <= 0) {
-        std::cerr << "[AUDIO] Invalid WAV parameters\n";
+void Server::dropListener(int fd) {
+    std::shared_ptr<AudioListener> listener;
+    {
+        std::lock_guard<std::mutex> lock(listeners_mutex);
+        auto it = listeners.find(fd);
+        if (it == listeners.end()) return;
+        listener = std::move(it->second);
+        listeners.erase(it);
+    }
+    if (listener->zerocopy.oldest() != ZeroCopyTracker::NONE) {
+        // zwykle close zostawia dane w gniezdzie i jadro wysyla je dalej prosto ze
+        // stron ring, ktore zegar nadpisze; RST odrzuca je od razu
+        linger abort{1, 0};
+        setsockopt(fd, SOL_SOCKET, SO_LINGER, &abort, sizeof(abort));
+    }
+    close(fd);
+}
+
+inline float pcm24ToFloat(const uint8_t* p) {
+    int32_t sample =
+        (p[0]) |
+        (p[1] << 8) |
+        (p[2] << 16);
+
+    if (sample & 0x800000)
+        sample |= ~0xFFFFFF;
+
+    return sample / 8388608.0f;
+}
+
+// Pierwszy utwor kolejki otwierany z wyprzedzeniem w drugim decku stacji.
+// Plik jest czytany bez zadnej blokady, wiec API kolejki nie czeka na dysk;
+// utwor zostaje w kolejce, dopoki nie zacznie grac.
+void Server::prefetchNextTrack(Station& station) {
+    NextTrack state = station.next_state.load(std::memory_order_acquire);
+    if (state == NextTrack::Ready && station.queue_version.load(std::memory_order_acquire) != station.prefetched_version) {
+        // kolejka sie zmienila - przygotowany utwor musi nadal byc pierwszy
+        std::lock_guard<std::mutex> lock(station.playlist_mutex);
+        station.prefetched_version = station.queue_version.load(std::memory_order_acquire);
+        bool still_first = !station.playlist.empty() && station.playlist.front().id == station.next_entry.id;
+        // nieudane CAS: zegar wlasnie go przejal, utwor i tak gra
+        if (!still_first)
+            station.next_state.compare_exchange_strong(state, NextTrack::None, std::memory_order_acq_rel);
+    }
+    if (station.next_state.load(std::memory_order_acquire) != NextTrack::None)
         return;
+
+    Track track;
+    {
+        std::lock_guard<std::mutex> lock(station.playlist_mutex);
+        if (station.playlist.empty()) return;
+        track = station.playlist.front();
+        station.prefetched_version = station.queue_version.load(std::memory_order_acquire);
+    }
+
+    try {
+        std::shared_ptr<const WavFile> wav = track_cache.get(track.filename);
+        station.decks[1 - station.active_deck.load(std::memory_order_acquire)]->open(wav, stream_format, CROSSFADE_FRAMES);
+        station.next_entry = track;
+        station.next_state.store(NextTrack::Ready, std::memory_order_release);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "[SERVER] Error loading track: " << e.what() << "\n";
+        std::lock_guard<std::mutex> lock(station.playlist_mutex);
+        if (!station.playlist.empty() && station.playlist.front().id == track.id) {
+            station.playlist.pop_front();
+            station.queue_version.fetch_add(1, std::memory_order_release);
+        }
+    }
+}
+
+// Po przejsciu (Switched): utwor schodzi z kolejki, a stacja oglasza go
+// sluchaczom - /audio od jego pierwszego bajtu w ring, /stream od poczatku przejscia.
+void Server::announceTrack(Station& station) {
+    const Track& track = station.next_entry;
+    {
+        std::lock_guard<std::mutex> lock(station.playlist_mutex);
+        if (!station.playlist.empty() && station.playlist.front().id == track.id) {
+            station.playlist.pop_front();
+            station.queue_version.fetch_add(1, std::memory_order_release);
+        }
     }
+    std::shared_ptr<const WavFile> wav = station.decks[station.active_deck.load(std::memory_order_acquire)]->track();
+    {
+        std::lock_guard<std::mutex> lock(station.playback_mutex);
+        station.wav = wav;
+        station.current_track_name = track.filename;
+        station.track_start_offset.store(station.switch_broadcast_offset.load(std::memory_order_relaxed), std::memory_order_release);
+        station.stream_track_start.store(station.switch_stream_offset.load(std::memory_order_relaxed), std::memory_order_release);
+        station.track_generation.fetch_add(1, std::memory_order_acq_rel);
+    }
+    station.next_state.store(NextTrack::None, std::memory_order_release);
+
+    std::cout << "[SERVER] Now playing on " << station.name << ": " << track.filename << "\n";
+    std::cout << "  Sample rate: " << wav->sampleRate << " Hz\n";
+    std::cout << "  Channels:    " << wav->channels << "\n";
+    std::cout << "  Bit depth:   " << wav->bitsPerSample << "\n";
+    std::cout << "  UI:          http://127.0.0.1:" << (port > 0 ? port : DEFAULT_HTTP_PORT) << "/";
+    if (station.index > 0) std::cout << "stations/" << station.name << "/";
+    std::cout << "\n";
+}
+
+// Watek stacji: przygotowuje nastepny utwor, doczytuje bufory i oglasza zmiany
+// utworow; same przejscia (takze /skip) robi zegar w advanceStation. Stacja
+// z lokalnym wyjsciem dostaje tempo od PortAudio; pozostale (albo gdy wyjscia
+// nie da sie otworzyc) odmierzaja czas same - co STATION_TICK_MS tyle ramek
+// strumienia, ile wynika z zegara od poczatku grania.
+void Server::stationLoop(Station& station) {
+    std::string thread_name = "station-" + station.name;
+    thread_name.resize(std::min<size_t>(thread_name.size(), 15)); // limit nazwy watku
+    pthread_setname_np(pthread_self(), thread_name.c_str());
+    if (station.local_output)
+        startAudioStream(station);
+    if (!station.audio_stream) {
+        // zegary rozlozone na rdzenie od konca - reaktor 0 (tick sluchaczy) zostaje na rdzeniu 0
+        unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET((cores - 1 - station.index % cores) % CPU_SETSIZE, &cpus);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    }
+
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point clock_start = Clock::now();
+    uint64_t clock_frames = 0;
+    Clock::time_point next_tick = Clock::now();
+
+    while (running) {
+        if (station.next_state.load(std::memory_order_acquire) == NextTrack::Switched)
+            announceTrack(station);
+        prefetchNextTrack(station);
+
+        // bufory utworow doczytywane w tym watku, zegar nigdy nie czeka na dysk
+        for (auto& deck : station.decks)
+            deck->fill();
+        // kodowanie segmentow HLS tez tutaj, nie w reaktorze - reaktor tylko je wysyla
+        station.hls->feed(*station.stream_ring);
+        if (station.audio_stream) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(STATION_TICK_MS));
+            continue;
+        }
+
+        // zegar programowy: pozycja wynika z czasu od poczatku grania, wiec
+        // spoznione wybudzenie nie przesuwa tempa, tylko daje wiekszy krok;
+        // niedoczytane ramki (pusty bufor) zostaja do nastepnego kroku
+        auto now = Clock::now();
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(now - clock_start);
+        uint64_t target = static_cast<uint64_t>(elapsed.count()) * STREAM_SAMPLE_RATE / 1000000;
+        if (target > clock_frames) {
+            size_t played = advanceStation(station, nullptr, static_cast<size_t>(target - clock_frames));
+            if (played == 0) {
+                // nic nie gra - zegar rusza od nowa z nastepnym utworem
+                clock_start = now;
+                clock_frames = 0;
+            } else {
+                clock_frames += played;
+            }
+        }
+        next_tick += std::chrono::milliseconds(STATION_TICK_MS);
+        now = Clock::now();
+        if (next_tick < now) next_tick = now;
+        std::this_thread::sleep_until(next_tick);
+    }
+    stopAudioStream(station);
+}
+
+// Lokalne wyjscie w formacie strumienia ciaglego, otwierane raz na caly czas
+// pracy stacji - przejscia miedzy utworami go nie dotykaja.
+void Server::startAudioStream(Station& station) {
+    if (station.audio_stream)
+        return;
 
     PaError err = Pa_OpenDefaultStream(
-        &audio_stream,
+        &station.audio_stream,
         0,
-        current_wav.channels,           
-        paFloat32,                      
-        current_wav.sampleRate,         
-        256,                            
-        portaudioCallback,              
-        this                            
+        stream_format.channels,
+        paFloat32,
+        stream_format.sample_rate,
+        256,
+        portaudioCallback,
+        &station
     );
 
     if (err != paNoError) {
         std::cerr << "[AUDIO] Error opening stream: " << Pa_GetErrorText(err) << "\n";
-        audio_stream = nullptr;
+        station.audio_stream = nullptr;
         return;
     }
 
-    err = Pa_StartStream(audio_stream);
+    err = Pa_StartStream(station.audio_stream);
     if (err != paNoError) {
         std::cerr << "[AUDIO] Error starting stream: " << Pa_GetErrorText(err) << "\n";
-        Pa_CloseStream(audio_stream);
-        audio_stream = nullptr;
+        Pa_CloseStream(station.audio_stream);
+        station.audio_stream = nullptr;
         return;
     }
 
-    std::cout << "[AUDIO] PortAudio stream started\n";
+    std::cout << "[AUDIO] PortAudio stream started (" << stream_format.sample_rate << " Hz, "
+              << stream_format.channels << " ch)\n";
 }
 
-void Server::stopAudioStream() {
-    if (audio_stream) {
-        Pa_StopStream(audio_stream);
-        Pa_CloseStream(audio_stream);
-        audio_stream = nullptr;
+void Server::stopAudioStream(Station& station) {
+    if (station.audio_stream) {
+        Pa_StopStream(station.audio_stream);
+        Pa_CloseStream(station.audio_stream);
+        station.audio_stream = nullptr;
         std::cout << "[AUDIO] PortAudio stream stopped\n";
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,141 @@
+#include "static_assets.h"
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sys/stat.h>
+
+#if STATIC_GZIP
+#include <zlib.h>
+#endif
+
+static std::string contentTypeFor(const std::string& name) {
+    auto dot = name.rfind('.');
+    std::string ext = dot == std::string::npos ? "" : name.substr(dot + 1);
+    if (ext == "html") return "text/html; charset=utf-8";
+    if (ext == "css")  return "text/css; charset=utf-8";
+    if (ext == "js")   return "text/javascript; charset=utf-8";
+    if (ext == "json") return "application/json";
+    if (ext == "svg")  return "image/svg+xml";
+    if (ext == "png")  return "image/png";
+    if (ext == "ico")  return "image/x-icon";
+    return "application/octet-stream";
+}
+
+static bool readFile(const std::string& path, std::string& out) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f) return false;
+    out.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+    return !f.bad();
+}
+
+// FNV-1a 64 - wystarczy do rozroznienia wersji pliku
+static std::string contentEtag(const std::string& data, const char* suffix) {
+    uint64_t h = 1469598103934665603ull;
+    for (unsigned char c : data) {
+        h ^= c;
+        h *= 1099511628211ull;
+    }
+    char buf[40];
+    std::snprintf(buf, sizeof(buf), "\"%016llx-%zx%s\"", static_cast<unsigned long long>(h), data.size(), suffix);
+    return buf;
+}
+
+#if STATIC_GZIP
+static bool gzipCompress(const std::string& in, std::string& out) {
+    z_stream zs{};
+    // 15 + 16: naglowek gzip zamiast zlib
+    if (deflateInit2(&zs, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        return false;
+    out.resize(deflateBound(&zs, in.size()) + 32);
+    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+    zs.avail_in = static_cast<uInt>(in.size());
+    zs.next_out = reinterpret_cast<Bytef*>(&out[0]);
+    zs.avail_out = static_cast<uInt>(out.size());
+    int rc = deflate(&zs, Z_FINISH);
+    out.resize(zs.total_out);
+    deflateEnd(&zs);
+    return rc == Z_STREAM_END;
+}
+#endif
+
+// gz: stat pliku .gz albo nullptr, gdy go nie ma - nowy albo podmieniony .gz
+// tez wymaga ponownego zaladowania
+static bool sameFile(const StaticAsset& a, const struct stat& st, const struct stat* gz) {
+    if (a.size != st.st_size || a.inode != st.st_ino ||
+        a.mtime.tv_sec != st.st_mtim.tv_sec || a.mtime.tv_nsec != st.st_mtim.tv_nsec)
+        return false;
+    if (!gz) return !a.gz_exists;
+    return a.gz_exists && a.gz_size == gz->st_size && a.gz_inode == gz->st_ino &&
+           a.gz_mtime.tv_sec == gz->st_mtim.tv_sec && a.gz_mtime.tv_nsec == gz->st_mtim.tv_nsec;
+}
+
+StaticAssetCache::StaticAssetCache(std::string root, std::chrono::milliseconds revalidate)
+    : root(std::move(root)), revalidate(revalidate) {}
+
+std::shared_ptr<const StaticAsset> StaticAssetCache::get(const std::string& name) {
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(mutex);
+
+    Entry& entry = entries[name];
+    if (entry.asset && now - entry.checked < revalidate)
+        return entry.asset;
+
+    std::string path = root + "/" + name;
+    struct stat st{};
+    if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+        entry.asset.reset();
+        entry.checked = now;
+        return nullptr;
+    }
+
+    struct stat gz{};
+    std::string gzPath = path + ".gz";
+    const struct stat* gzStat = stat(gzPath.c_str(), &gz) == 0 && S_ISREG(gz.st_mode) ? &gz : nullptr;
+
+    if (!entry.asset || !sameFile(*entry.asset, st, gzStat)) {
+        auto fresh = load(path, st, gzStat);
+        if (fresh) {
+            std::cout << "[STATIC] Loaded " << path << " (" << fresh->body.size() << " B"
+                      << (fresh->gzip_body.empty() ? "" : ", gzip " + std::to_string(fresh->gzip_body.size()) + " B")
+                      << ")\n";
+        }
+        entry.asset = fresh;
+    }
+    entry.checked = now;
+    return entry.asset;
+}
+
+std::shared_ptr<const StaticAsset> StaticAssetCache::load(const std::string& path, const struct stat& st,
+                                                          const struct stat* gz) const {
+    auto asset = std::make_shared<StaticAsset>();
+    if (!readFile(path, asset->body))
+        return nullptr;
+
+    asset->content_type = contentTypeFor(path);
+    asset->etag = contentEtag(asset->body, "");
+    asset->size = st.st_size;
+    asset->inode = st.st_ino;
+    asset->mtime = st.st_mtim;
+
+    // gotowy plik .gz obok oryginalu ma pierwszenstwo, o ile nie jest starszy
+    if (gz) {
+        asset->gz_exists = true;
+        asset->gz_size = gz->st_size;
+        asset->gz_inode = gz->st_ino;
+        asset->gz_mtime = gz->st_mtim;
+        if (gz->st_mtime >= st.st_mtime)
+            readFile(path + ".gz", asset->gzip_body);
+    }
+#if STATIC_GZIP
+    if (asset->gzip_body.empty() && !gzipCompress(asset->body, asset->gzip_body))
+        asset->gzip_body.clear();
+#endif
+
+    if (asset->gzip_body.size() >= asset->body.size())
+        asset->gzip_body.clear();
+    if (!asset->gzip_body.empty())
+        asset->gzip_etag = contentEtag(asset->gzip_body, "-gz");
+    return asset;
+}
@@ -0,0 +1,59 @@
+#include "track_stream.h"
+#include <algorithm>
+#include <cstring>
+
+TrackStream::TrackStream(size_t block_bytes, size_t blocks)
+    : ring(std::max<size_t>(block_bytes, 1) * std::max<size_t>(blocks, 2)),
+      block_bytes(std::max<size_t>(block_bytes, 1)),
+      read_ahead(ring.size()) {}
+
+void TrackStream::open(std::shared_ptr<const WavFile> next, size_t hold_bytes) {
+    wav = std::move(next);
+    // bufor tylko rosnie - kolejne utwory uzywaja tej samej pamieci
+    if (ring.size() < read_ahead + hold_bytes)
+        ring.resize(read_ahead + hold_bytes);
+    const size_t size = read_ahead + hold_bytes;
+    const size_t frame = wav ? static_cast<size_t>(wav->channels * (wav->bitsPerSample / 8)) : 0;
+    ring_bytes = frame ? size - size % frame : size;
+    released = 0;
+    filled.store(0, std::memory_order_relaxed);
+    consumed.store(0, std::memory_order_relaxed);
+    fill();
+}
+
+void TrackStream::fill() {
+    if (!wav) return;
+    const PcmData& data = wav->data;
+    const size_t size = data.size();
+    const size_t start = filled.load(std::memory_order_relaxed);
+    size_t end = start;
+    const size_t limit = std::min(size, consumed.load(std::memory_order_acquire) + ring_bytes);
+
+    while (end < limit) {
+        // niepelny blok tylko na koncu utworu - reszta poczeka na nastepne wywolanie
+        if (limit - end < block_bytes && limit < size) break;
+        size_t offset = end % ring_bytes;
+        size_t len = std::min({block_bytes, limit - end, ring_bytes - offset});
+        std::memcpy(ring.data() + offset, data.data() + end, len);
+        end += len;
+        filled.store(end, std::memory_order_release);
+    }
+
+    if (end == start) return;
+    // skopiowane strony mapowania nie sa juz potrzebne, nastepne czyta jadro w tle
+    data.release(released, end - released);
+    released = end;
+    if (end < size)
+        data.prefetch(end, ring_bytes);
+}
+
+const uint8_t* TrackStream::peek(size_t pos, size_t& len) const {
+    const size_t end = filled.load(std::memory_order_acquire);
+    if (pos >= end || ring_bytes == 0) {
+        len = 0;
+        return nullptr;
+    }
+    const size_t offset = pos % ring_bytes;
+    len = std::min({len, end - pos, ring_bytes - offset});
+    return ring.data() + offset;
+}
@@ -0,0 +1,154 @@
+#include "uring_send.h"
+#include <linux/io_uring.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+static int uringSetup(unsigned entries, io_uring_params* params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+static int uringEnter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+static int uringRegister(int fd, unsigned opcode, const void* arg, unsigned nr_args) {
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+
+template <typename T>
+static T* at(void* base, unsigned offset) {
+    return reinterpret_cast<T*>(static_cast<char*>(base) + offset);
+}
+
+UringSender::UringSender(unsigned entries) {
+    io_uring_params params{};
+    ring_fd = uringSetup(entries, &params);
+    if (ring_fd < 0) {
+        std::cerr << "[URING] io_uring_setup failed: " << std::strerror(errno) << "\n";
+        return;
+    }
+
+    sq_ring_bytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_bytes = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap)
+        sq_ring_bytes = cq_ring_bytes = std::max(sq_ring_bytes, cq_ring_bytes);
+
+    sq_ptr = mmap(nullptr, sq_ring_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+    if (sq_ptr == MAP_FAILED) {
+        sq_ptr = nullptr;
+        release();
+        return;
+    }
+    if (single_mmap) {
+        cq_ptr = sq_ptr;
+    } else {
+        cq_ptr = mmap(nullptr, cq_ring_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+        if (cq_ptr == MAP_FAILED) {
+            cq_ptr = nullptr;
+            release();
+            return;
+        }
+    }
+    sqes_bytes = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqe_mem = mmap(nullptr, sqes_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+    if (sqe_mem == MAP_FAILED) {
+        release();
+        return;
+    }
+    sqes = static_cast<io_uring_sqe*>(sqe_mem);
+
+    sq_head = at<unsigned>(sq_ptr, params.sq_off.head);
+    sq_tail = at<unsigned>(sq_ptr, params.sq_off.tail);
+    sq_array = at<unsigned>(sq_ptr, params.sq_off.array);
+    sq_mask = *at<unsigned>(sq_ptr, params.sq_off.ring_mask);
+    sq_entries = params.sq_entries;
+
+    cq_head = at<unsigned>(cq_ptr, params.cq_off.head);
+    cq_tail = at<unsigned>(cq_ptr, params.cq_off.tail);
+    cqes = at<io_uring_cqe>(cq_ptr, params.cq_off.cqes);
+    cq_mask = *at<unsigned>(cq_ptr, params.cq_off.ring_mask);
+
+    event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (event_fd < 0 || uringRegister(ring_fd, IORING_REGISTER_EVENTFD, &event_fd, 1) < 0) {
+        std::cerr << "[URING] cannot register eventfd: " << std::strerror(errno) << "\n";
+        release();
+        return;
+    }
+
+    if (!(params.features & IORING_FEAT_NODROP))
+        std::cerr << "[URING] kernel may drop completions on CQ overflow\n";
+}
+
+UringSender::~UringSender() {
+    release();
+}
+
+void UringSender::release() {
+    if (sqes) munmap(sqes, sqes_bytes);
+    if (cq_ptr && cq_ptr != sq_ptr) munmap(cq_ptr, cq_ring_bytes);
+    if (sq_ptr) munmap(sq_ptr, sq_ring_bytes);
+    sqes = nullptr;
+    sq_ptr = cq_ptr = nullptr;
+    if (event_fd >= 0) close(event_fd);
+    if (ring_fd >= 0) close(ring_fd);
+    event_fd = ring_fd = -1;
+}
+
+bool UringSender::sendmsg(int fd, const msghdr* msg, int flags, uint64_t user_data) {
+    unsigned tail = *sq_tail;
+    unsigned head = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+    if (tail - head >= sq_entries)
+        return false;
+
+    unsigned idx = tail & sq_mask;
+    io_uring_sqe* sqe = &sqes[idx];
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(msg);
+    sqe->len = 1;
+    sqe->msg_flags = static_cast<uint32_t>(flags);
+    sqe->user_data = user_data;
+
+    sq_array[idx] = idx;
+    __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ++pending_submit;
+    return true;
+}
+
+int UringSender::submit() {
+    int accepted = 0;
+    while (pending_submit > 0) {
+        int r = uringEnter(ring_fd, pending_submit, 0, 0);
+        ++enter_calls;
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            // EAGAIN/EBUSY: brak zasobow albo przepelnione CQ - reszta pojdzie w nastepnym ticku
+            return accepted > 0 ? accepted : -1;
+        }
+        pending_submit -= static_cast<unsigned>(r);
+        accepted += r;
+        if (r == 0) break;
+    }
+    return accepted;
+}
+
+bool UringSender::popCompletion(uint64_t& user_data, int& res) {
+    unsigned head = *cq_head;
+    unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+    if (head == tail)
+        return false;
+
+    const io_uring_cqe& cqe = cqes[head & cq_mask];
+    user_data = cqe.user_data;
+    res = cqe.res;
+    __atomic_store_n(cq_head, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
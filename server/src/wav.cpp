@@ -0,0 +1,138 @@
+#include "wav.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static uintptr_t pageSize() {
+    static const uintptr_t size = [] {
+        long page = sysconf(_SC_PAGESIZE);
+        return static_cast<uintptr_t>(page > 0 ? page : 4096);
+    }();
+    return size;
+}
+
+// czytanie z wyprzedzeniem - poczatek zakresu w dol do strony
+void PcmData::prefetch(size_t offset, size_t count) const {
+    if (!ptr || offset >= len || count == 0) return;
+    count = std::min(count, len - offset);
+    uintptr_t from = reinterpret_cast<uintptr_t>(ptr + offset);
+    uintptr_t start = from - from % pageSize();
+    madvise(reinterpret_cast<void*>(start), from + count - start, MADV_WILLNEED);
+}
+
+// strony od poczatku zakresu do ostatniej pelnej; czesciowa strona na koncu zostaje do nastepnego wywolania
+void PcmData::release(size_t offset, size_t count) const {
+    if (!ptr || offset >= len || count == 0) return;
+    count = std::min(count, len - offset);
+    uintptr_t from = reinterpret_cast<uintptr_t>(ptr + offset);
+    uintptr_t start = from - from % pageSize();
+    uintptr_t end = from + count;
+    end -= end % pageSize();
+    if (end > start)
+        madvise(reinterpret_cast<void*>(start), end - start, MADV_DONTNEED);
+}
+
+static uint32_t readU32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+static uint16_t readU16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+WavFile loadWavFile(const std::string& filename) {
+    int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        throw std::runtime_error("Cannot open WAV file: " + filename);
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || st.st_size < 12) {
+        close(fd);
+        throw std::runtime_error("Not a RIFF file");
+    }
+    const size_t size = static_cast<size_t>(st.st_size);
+    void* addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED)
+        throw std::runtime_error("Cannot map WAV file: " + filename);
+    std::shared_ptr<const void> mapping(addr, [size](const void* p) { munmap(const_cast<void*>(p), size); });
+    // odtwarzanie czyta plik od poczatku do konca
+    madvise(addr, size, MADV_SEQUENTIAL);
+
+    const uint8_t* file = static_cast<const uint8_t*>(addr);
+    if (std::memcmp(file, "RIFF", 4) != 0)
+        throw std::runtime_error("Not a RIFF file");
+    if (std::memcmp(file + 8, "WAVE", 4) != 0)
+        throw std::runtime_error("Not a WAVE file");
+
+    WavFile wav;
+    bool have_fmt = false;
+    size_t offset = 12;
+    while (offset + 8 <= size) {
+        const uint8_t* chunkId = file + offset;
+        const size_t chunkSize = readU32(file + offset + 4);
+        const size_t body = offset + 8;
+
+        if (std::memcmp(chunkId, "fmt ", 4) == 0) {
+            if (chunkSize < 16 || body + 16 > size)
+                throw std::runtime_error("Invalid fmt chunk");
+            uint16_t audioFormat = readU16(file + body);
+            wav.channels = readU16(file + body + 2);
+            wav.sampleRate = static_cast<int>(readU32(file + body + 4));
+            wav.bitsPerSample = readU16(file + body + 14);
+
+            if (wav.channels == 0 || wav.sampleRate <= 0)
+                throw std::runtime_error("Invalid fmt chunk");
+
+            if (audioFormat != 1)
+                throw std::runtime_error("Only PCM WAV supported");
+
+            if (wav.bitsPerSample != 24 && wav.bitsPerSample != 16)
+                throw std::runtime_error("Only 16-bit or 24-bit WAV supported");
+            have_fmt = true;
+        }
+        else if (std::memcmp(chunkId, "data", 4) == 0) {
+            // obciety plik: tylko to, co faktycznie jest na dysku
+            size_t len = std::min(chunkSize, size - body);
+            wav.data = PcmData(mapping, file + body, len);
+            break;
+        }
+        // chunki RIFF sa wyrownane do parzystej dlugosci
+        offset = body + chunkSize + (chunkSize & 1);
+    }
+
+    if (!have_fmt)
+        throw std::runtime_error("No fmt chunk found");
+    if (wav.data.empty())
+        throw std::runtime_error("No audio data found");
+
+    return wav;
+}
+
+static void writeU32(uint8_t* p, uint32_t v) {
+    p[0] = v & 0xFF; p[1] = (v >> 8) & 0xFF; p[2] = (v >> 16) & 0xFF; p[3] = (v >> 24) & 0xFF;
+}
+
+static void writeU16(uint8_t* p, uint16_t v) {
+    p[0] = v & 0xFF; p[1] = (v >> 8) & 0xFF;
+}
+
+void writeWavHeader(uint8_t* dst, int sample_rate, int channels, int bits, uint32_t data_size) {
+    const uint16_t block_align = static_cast<uint16_t>(channels * (bits / 8));
+    std::memcpy(dst, "RIFF", 4);
+    writeU32(dst + 4, data_size == 0xFFFFFFFFu ? 0xFFFFFFFFu : 36 + data_size);
+    std::memcpy(dst + 8, "WAVE", 4);
+    std::memcpy(dst + 12, "fmt ", 4);
+    writeU32(dst + 16, 16);
+    writeU16(dst + 20, 1);
+    writeU16(dst + 22, static_cast<uint16_t>(channels));
+    writeU32(dst + 24, static_cast<uint32_t>(sample_rate));
+    writeU32(dst + 28, static_cast<uint32_t>(sample_rate) * block_align);
+    writeU16(dst + 32, block_align);
+    writeU16(dst + 34, static_cast<uint16_t>(bits));
+    std::memcpy(dst + 36, "data", 4);
+    writeU32(dst + 40, data_size);
+}
@@ -0,0 +1,68 @@
+#include "worker_pool.h"
+#include <iostream>
+#include <pthread.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+WorkerPool::WorkerPool(size_t threads, std::string name, int nice_delta)
+    : name(std::move(name)), nice_delta(nice_delta) {
+    if (threads == 0) threads = 1;
+    workers.reserve(threads);
+    for (size_t i = 0; i < threads; ++i)
+        workers.emplace_back(&WorkerPool::workerLoop, this, i);
+}
+
+WorkerPool::~WorkerPool() {
+    stop();
+}
+
+void WorkerPool::submit(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(tasks_mutex);
+        if (stopping) return;
+        tasks.push_back(std::move(task));
+    }
+    tasks_cv.notify_one();
+}
+
+void WorkerPool::stop() {
+    {
+        std::lock_guard<std::mutex> lock(tasks_mutex);
+        if (stopping) return;
+        stopping = true;
+    }
+    tasks_cv.notify_all();
+    for (auto& t : workers)
+        if (t.joinable()) t.join();
+}
+
+void WorkerPool::workerLoop(size_t index) {
+    // nazwa widoczna w top -H / gdb (limit 15 znakow)
+    std::string thread_name = (name + "-" + std::to_string(index)).substr(0, 15);
+    pthread_setname_np(pthread_self(), thread_name.c_str());
+
+    // w Linuksie nice dotyczy pojedynczego watku
+    if (nice_delta != 0) {
+        pid_t tid = static_cast<pid_t>(syscall(SYS_gettid));
+        int current = getpriority(PRIO_PROCESS, static_cast<id_t>(tid));
+        if (setpriority(PRIO_PROCESS, static_cast<id_t>(tid), current + nice_delta) != 0)
+            std::cerr << "[WORKER] " << thread_name << ": cannot change priority\n";
+    }
+
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(tasks_mutex);
+            tasks_cv.wait(lock, [this]{ return stopping || !tasks.empty(); });
+            if (stopping && tasks.empty()) return;
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        try {
+            task();
+        } catch (const std::exception& e) {
+            std::cerr << "[WORKER] Task failed: " << e.what() << "\n";
+        }
+    }
+}